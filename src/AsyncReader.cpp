@@ -0,0 +1,289 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * AsyncReader.cpp
+ */
+
+#include "AsyncReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <utility>
+
+#include <fcntl.h> // open()
+#include <sys/stat.h> // stat()
+#include <unistd.h> // pread(), close()
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+/*
+ * Reads a whole file with blocking reads. Returns false on errors.
+ */
+static bool read_file(const std::string &name, std::string &data) {
+    const int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    data.resize(st.st_size);
+    std::size_t off = 0U;
+    while (off < data.size()) {
+        const ssize_t n = pread(fd, &data[off], data.size() - off, off);
+        if (n < 0 and errno == EINTR) {
+            continue;
+        } else if (n < 0) {
+            close(fd);
+            data.clear();
+            return false;
+        } else if (n == 0) {
+            // The file was truncated since fstat()
+            data.resize(off);
+        }
+        off += n;
+    }
+    close(fd);
+    return true;
+}
+
+#ifdef HAVE_LIBURING
+/*
+ * Returns true if io_uring can be set up, i.e., the kernel supports it
+ * and it is not disabled.
+ */
+static bool uring_available() {
+    static const bool available = []() {
+        struct io_uring ring;
+        if (io_uring_queue_init(1U, &ring, 0U) < 0) {
+            return false;
+        }
+        io_uring_queue_exit(&ring);
+        return true;
+    }();
+    return available;
+}
+#else
+static bool uring_available() {
+    return false;
+}
+#endif
+
+const char *AsyncReader::backend() {
+    return uring_available() ? "io_uring" : "pread";
+}
+
+AsyncReader::AsyncReader(const std::vector<std::string> &names,
+                         unsigned int depth) :
+        names(names), depth(std::max(depth, 1U)), order(names.size()),
+        mutex(), ready_cond(), room_cond(), ready(), in_flight(0U),
+        done(0U), next_file(0U), stopping(false), threads() {
+    // Submit in the order of the inodes, files that cannot be found last
+    std::vector<std::pair<std::pair<dev_t, ino_t>, unsigned int> > keys;
+    keys.reserve(names.size());
+    for (unsigned int i = 0U; i < names.size(); i++) {
+        struct stat st;
+        if (stat(names[i].c_str(), &st) == 0) {
+            keys.push_back({{st.st_dev, st.st_ino}, i});
+        } else {
+            keys.push_back({{static_cast<dev_t>(-1), static_cast<ino_t>(-1)},
+                            i});
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    for (unsigned int i = 0U; i < keys.size(); i++) {
+        order[i] = keys[i].second;
+    }
+
+    if (uring_available()) {
+        threads.create_thread([this]() {
+            read_uring();
+        });
+    } else {
+        for (unsigned int i = 0U; i < this->depth; i++) {
+            threads.create_thread([this]() {
+                read_blocking();
+            });
+        }
+    }
+}
+
+AsyncReader::~AsyncReader() {
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        stopping = true;
+        room_cond.notify_all();
+    }
+    threads.join_all();
+}
+
+bool AsyncReader::claim(unsigned int &index, bool block) {
+    boost::mutex::scoped_lock lock(mutex);
+    while (not stopping and next_file < order.size()
+           and ready.size() + in_flight >= depth) {
+        if (not block) {
+            return false;
+        }
+        room_cond.wait(lock);
+    }
+    if (stopping or next_file >= order.size()) {
+        return false;
+    }
+    index = order[next_file++];
+    in_flight++;
+    return true;
+}
+
+void AsyncReader::deliver(ReadBuffer &&buf) {
+    boost::mutex::scoped_lock lock(mutex);
+    in_flight--;
+    ready.push_back(std::move(buf));
+    ready_cond.notify_one();
+}
+
+bool AsyncReader::next(ReadBuffer &buf) {
+    boost::mutex::scoped_lock lock(mutex);
+    while (ready.empty() and done < order.size()) {
+        ready_cond.wait(lock);
+    }
+    if (ready.empty()) {
+        return false;
+    }
+    buf = std::move(ready.front());
+    ready.pop_front();
+    done++;
+    room_cond.notify_all();
+    return true;
+}
+
+void AsyncReader::read_blocking() {
+    unsigned int index;
+    while (claim(index, true)) {
+        ReadBuffer buf{index, std::string(), false};
+        buf.ok = read_file(names[index], buf.data);
+        deliver(std::move(buf));
+    }
+}
+
+#ifdef HAVE_LIBURING
+namespace {
+/*
+ * A file being read through the ring.
+ */
+struct UringRead {
+    unsigned int index;
+    int fd;
+    std::string data;
+    std::size_t off;
+};
+
+void submit_read(struct io_uring &ring, UringRead *r) {
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_read(sqe, r->fd, &r->data[r->off], r->data.size() - r->off,
+                       r->off);
+    io_uring_sqe_set_data(sqe, r);
+}
+}
+
+/*
+ * Opens files and submits their reads while there is room, then reaps
+ * completions. Files are opened synchronously, only the reads go
+ * through the ring. Short reads are resubmitted for the rest.
+ */
+void AsyncReader::read_uring() {
+    struct io_uring ring;
+    if (io_uring_queue_init(depth, &ring, 0U) < 0) {
+        read_blocking();
+        return;
+    }
+    unsigned int pending = 0U;
+    bool more = true;
+    while (more or pending > 0U) {
+        unsigned int index;
+        // Only wait for room when there are no completions to wait for
+        while (more and claim(index, pending == 0U)) {
+            ReadBuffer failed{index, std::string(), false};
+            const int fd = open(names[index].c_str(), O_RDONLY);
+            struct stat st;
+            if (fd < 0 or fstat(fd, &st) != 0) {
+                if (fd >= 0) {
+                    close(fd);
+                }
+                deliver(std::move(failed));
+                continue;
+            }
+            if (st.st_size == 0) {
+                close(fd);
+                deliver(ReadBuffer{index, std::string(), true});
+                continue;
+            }
+            UringRead *r = new UringRead{index, fd, std::string(), 0U};
+            r->data.resize(st.st_size);
+            submit_read(ring, r);
+            pending++;
+        }
+        if (pending == 0U) {
+            // A blocking claim() only fails if there are no more files
+            // or the reader is stopping
+            more = false;
+            continue;
+        }
+        io_uring_submit(&ring);
+
+        struct io_uring_cqe *cqe;
+        if (io_uring_wait_cqe(&ring, &cqe) < 0) {
+            continue;
+        }
+        do {
+            UringRead *r = static_cast<UringRead *>(io_uring_cqe_get_data(cqe));
+            const int res = cqe->res;
+            io_uring_cqe_seen(&ring, cqe);
+            if (res == -EINTR or res == -EAGAIN) {
+                submit_read(ring, r);
+                continue;
+            }
+            bool ok = res >= 0;
+            if (res > 0) {
+                r->off += res;
+                if (r->off < r->data.size()) {
+                    submit_read(ring, r);
+                    continue;
+                }
+            } else if (res == 0) {
+                // The file was truncated since fstat()
+                r->data.resize(r->off);
+            } else {
+                r->data.clear();
+            }
+            close(r->fd);
+            pending--;
+            deliver(ReadBuffer{r->index, std::move(r->data), ok});
+            delete r;
+        } while (io_uring_peek_cqe(&ring, &cqe) == 0);
+    }
+    io_uring_queue_exit(&ring);
+}
+#else
+void AsyncReader::read_uring() {
+    read_blocking();
+}
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * AsyncReader.h
+ */
+
+#ifndef ASYNCREADER_H_
+#define ASYNCREADER_H_
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>	// boost::mutex, boost::thread
+
+/*!
+ * \brief The contents of a file read by an AsyncReader.
+ */
+struct ReadBuffer {
+    // The index of the file in the list given to the reader
+    unsigned int index;
+    // The contents of the file
+    std::string data;
+    // False if the file could not be read, data is then empty
+    bool ok;
+};
+
+/*!
+ * \brief Reads a list of whole files with many reads in flight.
+ *
+ * Reading small files one at a time per thread leaves most of the
+ * bandwidth of fast or networked storage unused. An AsyncReader reads
+ * up to depth files at once in the background and hands out their
+ * contents in the order in which the reads complete.
+ *
+ * The files are first sorted by device and inode number, which mostly
+ * follows their placement on disk. If the library is built with
+ * liburing, the reads are submitted in a single io_uring. Otherwise,
+ * depth threads read the files with blocking pread() calls.
+ *
+ * At most depth files are read or wait for the consumer at any time,
+ * which bounds the memory use. Several compute threads may take files
+ * with next() at once.
+ */
+class AsyncReader {
+private:
+    const std::vector<std::string> &names;
+    const unsigned int depth;
+    // The indices of the files in submission order
+    std::vector<unsigned int> order;
+
+    boost::mutex mutex;
+    boost::condition_variable ready_cond, room_cond;
+    // Files read but not yet taken by next()
+    std::deque<ReadBuffer> ready;
+    // Number of files being read
+    unsigned int in_flight;
+    // Number of files handed out by next()
+    std::size_t done;
+    // The position in order of the next file to submit
+    std::size_t next_file;
+    // Set to stop the background reads early
+    bool stopping;
+    boost::thread_group threads;
+
+    /*
+     * Waits until a file may be submitted and returns its index, or
+     * returns false if there are no more files.
+     */
+    bool claim(unsigned int &index, bool block);
+    /*
+     * Stores the contents of a file.
+     */
+    void deliver(ReadBuffer &&buf);
+    // The reading threads of the two back ends
+    void read_blocking();
+    void read_uring();
+public:
+    /*!
+     * \brief Starts reading the files.
+     *
+     * @param names the names of the files, which must outlive the
+     * reader.
+     * @param depth the maximal number of files read at once.
+     */
+    AsyncReader(const std::vector<std::string> &names, unsigned int depth);
+
+    /*!
+     * \brief Stops the reads in flight and waits for them.
+     */
+    ~AsyncReader();
+
+    AsyncReader(const AsyncReader &) = delete;
+    AsyncReader &operator=(const AsyncReader &) = delete;
+
+    /*!
+     * \brief Takes the next file read, waiting for one if needed.
+     *
+     * @return false once all files have been handed out.
+     */
+    bool next(ReadBuffer &buf);
+
+    /*!
+     * \brief Returns the name of the I/O back end, "io_uring" or "pread".
+     */
+    static const char *backend();
+};
+
+#endif /* ASYNCREADER_H_ */
@@ -0,0 +1,435 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * CachePool.cpp
+ */
+
+#include "CachePool.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <boost/thread.hpp>	// boost::mutex, boost::thread_group
+#include <quickly/DataAction.h>
+#include <quickly/ThreadPool.h>
+
+#include "trace.h"
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+class DataActionImpl: public quickly::DataActionBase {
+private:
+    explicit DataActionImpl(unsigned int id) :
+            DataActionBase(id) {
+    }
+    // A mutex for thread safety
+    static boost::mutex print_mutex;
+    // The file names of the current window, largest first
+    static std::vector<std::string> files;
+    // The sizes of the files in bytes
+    static std::vector<std::uintmax_t> sizes;
+    // The indices of the files in the window, in list order
+    static std::vector<std::size_t> indices;
+    // The directory where to store the caches
+    static fs::path cache_dir;
+    // The live counters of the status file, if any
+    static Telemetry *telemetry;
+    // Where to pass the outputs on to, if anywhere
+    static const CachePool::Sink *sink;
+public:
+    // Dummy constructor
+    DataActionImpl() :
+            DataActionBase(UINT_MAX) {
+    }
+    virtual ~DataActionImpl() {
+    }
+    // Virtual constructor
+    virtual DataActionImpl *create(unsigned int id) {
+        return new DataActionImpl(id);
+    }
+
+    // Static constructor
+    static void init(const fs::path &cache_dir, Telemetry *telemetry) {
+        DataActionImpl::cache_dir = cache_dir;
+        DataActionImpl::telemetry = telemetry;
+    }
+    static void clearFiles() {
+        files.clear();
+        sizes.clear();
+        indices.clear();
+    }
+    static void addFile(const std::string &newfile, std::uintmax_t size,
+                        std::size_t index) {
+        files.push_back(newfile);
+        sizes.push_back(size);
+        indices.push_back(index);
+    }
+    static const std::vector<std::string> &getFiles() {
+        return files;
+    }
+    static const std::vector<std::uintmax_t> &getSizes() {
+        return sizes;
+    }
+    static void setSink(const CachePool::Sink *sink) {
+        DataActionImpl::sink = sink;
+    }
+
+    // Overridden doFull() method
+    virtual void doFull(std::stringstream &databuf);
+};
+
+boost::mutex DataActionImpl::print_mutex;
+std::vector<std::string> DataActionImpl::files;
+std::vector<std::uintmax_t> DataActionImpl::sizes;
+std::vector<std::size_t> DataActionImpl::indices;
+fs::path DataActionImpl::cache_dir;
+Telemetry *DataActionImpl::telemetry = nullptr;
+const CachePool::Sink *DataActionImpl::sink = nullptr;
+
+void DataActionImpl::doFull(std::stringstream &databuf) {
+    HIDOST_TRACE1(action_start, getId());
+    fs::path of_path(DataActionImpl::cache_dir);
+    of_path /= files[getId()];
+
+    // Open the cache file
+    std::ofstream of(of_path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!of) {
+        // Try recreating the missing directory structure
+        if (not fs::create_directories(of_path.parent_path())) {
+            boost::mutex::scoped_lock lock(print_mutex);
+            std::cerr << "Unable to open file " << of_path.c_str() << std::endl;
+            return;
+        } else {
+            // Open the cache file again
+            of.open(of_path.c_str(), std::ios::binary | std::ios::trunc);
+            if (!of) {
+                boost::mutex::scoped_lock lock(print_mutex);
+                std::cerr << "Unable to open file " << of_path.c_str()
+                          << std::endl;
+                return;
+            }
+        }
+    }
+    // Copy the output from the child into the cache file
+    const std::size_t nbytes = databuf.rdbuf()->in_avail();
+    if (nbytes > 0U) {
+        of << databuf.rdbuf();
+    }
+    of.close();
+    if (telemetry != nullptr) {
+        telemetry->job_done(sizes[getId()], nbytes);
+    }
+    if (sink != nullptr and *sink) {
+        (*sink)(indices[getId()], databuf.str());
+    }
+    HIDOST_TRACE1(action_done, getId());
+}
+
+/*
+ * Each check waits for the file system, so they run in parallel.
+ */
+bool read_window(std::istream &in, unsigned int window,
+                 sizedvector &sized_files) {
+    std::vector<std::string> lines;
+    std::string line;
+    while ((window == 0U or lines.size() < window)
+           and std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    if (lines.empty()) {
+        return false;
+    }
+
+    // The checked files, with the reason to skip them, if any
+    sizedvector checked(lines.size());
+    std::vector<const char *> skipped(lines.size(), nullptr);
+    const unsigned int nthreads = std::min<std::size_t>(16U, lines.size());
+    boost::thread_group threads;
+    for (unsigned int t = 0U; t < nthreads; t++) {
+        threads.create_thread([&, t]() {
+            for (std::size_t i = t; i < lines.size(); i += nthreads) {
+                boost::system::error_code ec;
+                const fs::file_status status = fs::status(lines[i], ec);
+                if (not fs::exists(status)) {
+                    skipped[i] = "Skipping nonexistent file ";
+                } else if (fs::is_directory(status)) {
+                    skipped[i] = "Skipping directory ";
+                } else {
+                    checked[i].first = fs::file_size(lines[i], ec);
+                    if (not ec) {
+                        checked[i].second = fs::canonical(lines[i],
+                                                          ec).string();
+                    }
+                    if (ec) {
+                        skipped[i] = "Skipping unreadable file ";
+                    }
+                }
+            }
+        });
+    }
+    threads.join_all();
+
+    for (std::size_t i = 0U; i < lines.size(); i++) {
+        if (skipped[i] == nullptr) {
+            sized_files.push_back(std::move(checked[i]));
+        } else {
+            std::cerr << skipped[i] << lines[i] << std::endl;
+        }
+    }
+    return true;
+}
+
+po::options_description CachePool::options(const char *vm_limit) {
+    po::options_description desc;
+    desc.add_options()
+            ("cache,c",
+                    po::value<std::string>()->required(),
+                    "where to cache")
+            ("compact", "perform feature compaction")
+            ("values", "use values instead of presence as features")
+            ("swf", "the input files are SWF files")
+            (vm_limit,
+                    po::value<unsigned int>()->default_value(0U),
+                    "limit the virtual memory of child processes in "
+                    "MB (default: no limit)")
+            ("cpu-time,t",
+                    po::value<unsigned int>()->default_value(0U),
+                    "limit the CPU time of child processes in seconds "
+                    "(default: no limit)")
+            ("parallel,N",
+                    po::value<unsigned int>()->default_value(0U),
+                    "number of child processes to run in parallel "
+                    "(default: number of cores minus one)")
+            ("mem-budget,B",
+                    po::value<unsigned int>()->default_value(0U),
+                    "total memory in MB that all child processes running "
+                    "in parallel may use together; child processes wait "
+                    "until their estimated memory use fits (default: no "
+                    "budget)")
+            ("mem-base",
+                    po::value<unsigned int>()->default_value(32U),
+                    "estimated memory in MB used by a child process "
+                    "regardless of the input file size; estimates are at "
+                    "least 1 MB")
+            ("mem-factor",
+                    po::value<double>()->default_value(4.0),
+                    "initial estimate of the child process memory use "
+                    "per byte of input; replaced by the average observed "
+                    "peak memory use of finished child processes")
+            ("window,W",
+                    po::value<unsigned int>()->default_value(100000U),
+                    "the number of input files read, checked and "
+                    "processed largest first at a time; 0 reads the whole "
+                    "list at once")
+            ("status",
+                    po::value<std::string>(),
+                    "write live counters of the worker pools, such as "
+                    "busy workers, finished files and the ETA, as a JSON "
+                    "object to this file every second")
+            ("metrics",
+                    po::value<std::string>(),
+                    "append per-document extraction metrics as JSON lines "
+                    "to this file")
+            ("features",
+                    po::value<std::string>(),
+                    "only extract the paths in this NPPF feature file and "
+                    "do not traverse the document branches that cannot "
+                    "lead to one of them, see pdf2paths --help")
+            ("dedup",
+                    "do not expand repeated dictionaries and streams of a "
+                    "document again, see pdf2paths --help");
+    return desc;
+}
+
+CachePool::CachePool(const po::variables_map &vm, const char *program,
+                     const CachePrograms &programs) :
+        cache_dir(), prog_name(programs.pdf2paths), gate_prog(programs.self),
+        do_compact(vm.count("compact") > 0), child_options(),
+        vm_limit_mb(vm["vm-limit"].as<unsigned int>()),
+        cpu_limit(vm["cpu-time"].as<unsigned int>()),
+        parallel(vm["parallel"].as<unsigned int>()),
+        window(vm["window"].as<unsigned int>()), gate(), telemetry() {
+    const std::string dir = vm["cache"].as<std::string>();
+    if (not fs::is_directory(dir)) {
+        throw "Please specify an existing directory for --cache.";
+    }
+    cache_dir = fs::canonical(dir);
+
+    if (vm.count("metrics")) {
+        child_options.push_back("--metrics");
+        child_options.push_back(
+                fs::absolute(vm["metrics"].as<std::string>()).string());
+    }
+    if (vm.count("features")) {
+        child_options.push_back("--features");
+        child_options.push_back(
+                fs::absolute(vm["features"].as<std::string>()).string());
+    }
+    if (vm.count("dedup")) {
+        child_options.push_back("--dedup");
+    }
+    const bool use_values = vm.count("values") > 0;
+    if (vm.count("swf")) {
+        if (vm.count("features") or vm.count("dedup")) {
+            throw "--features and --dedup are not supported for SWF files.";
+        }
+        prog_name = programs.swf2paths;
+        if (use_values) {
+            child_options.push_back("--values");
+        }
+    } else if (use_values) {
+        prog_name = programs.pdf2vals;
+    }
+
+    // Under a memory budget, child processes wait for their memory
+    const unsigned int mem_budget = vm["mem-budget"].as<unsigned int>();
+    if (mem_budget > 0U) {
+        gate.reset(new MemGate(mem_budget, vm["mem-base"].as<unsigned int>(),
+                               vm["mem-factor"].as<double>()));
+    }
+    if (vm.count("status")) {
+        telemetry.reset(new Telemetry(vm["status"].as<std::string>(),
+                                      program));
+    }
+    DataActionImpl::init(cache_dir, telemetry.get());
+}
+
+CachePool::~CachePool() {
+    DataActionImpl::init(fs::path(), nullptr);
+}
+
+std::string CachePool::cache_path(const std::string &file) const {
+    fs::path path(cache_dir);
+    path /= file;
+    return path.string();
+}
+
+void CachePool::run(std::istream &list, const WindowFn &on_window,
+                    const Sink &sink) {
+    sizedvector sized_files, next_files;
+    bool more = read_window(list, window, sized_files);
+    while (more) {
+        // Check the next window while the current one is processed
+        next_files.clear();
+        boost::thread reader([&]() {
+            more = read_window(list, window, next_files);
+        });
+        try {
+            if (not sized_files.empty()) {
+                if (on_window) {
+                    on_window(sized_files);
+                }
+                run_window(sized_files, sink);
+            }
+        } catch (...) {
+            reader.join();
+            throw;
+        }
+        reader.join();
+        sized_files.swap(next_files);
+    }
+}
+
+/*
+ * Processes the files of a window, largest first, in a single pool. With
+ * a gate, every child process runs through a gate of gate_prog, which
+ * starts it once its memory fits the budget, and files estimated to need
+ * more than the virtual memory limit are reported, as the limit stays in
+ * force.
+ */
+void CachePool::run_window(sizedvector &sized_files, const Sink &sink) {
+    // Largest files first, so that they do not make up a long tail
+    std::vector<std::size_t> order(sized_files.size());
+    for (std::size_t i = 0U; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&sized_files](std::size_t a, std::size_t b) {
+                         return sized_files[a].first > sized_files[b].first;
+                     });
+    DataActionImpl::clearFiles();
+    for (const std::size_t i : order) {
+        DataActionImpl::addFile(sized_files[i].second, sized_files[i].first,
+                                i);
+    }
+    const std::vector<std::string> &files = DataActionImpl::getFiles();
+    const std::vector<std::uintmax_t> &sizes = DataActionImpl::getSizes();
+
+    if (gate) {
+        std::cerr << "Running " << files.size() << " files of up to "
+                  << sizes.front() << " bytes, estimated "
+                  << gate->estimate(sizes.front()) << " MB for the largest"
+                  << std::endl;
+        for (std::size_t i = 0U; i < files.size(); i++) {
+            const double need = gate->estimate(sizes[i]);
+            if (vm_limit_mb == 0U or need <= vm_limit_mb) {
+                break;
+            }
+            std::cerr << "File " << files[i] << " is estimated to need "
+                      << need << " MB, more than the --vm-limit of "
+                      << vm_limit_mb << " MB" << std::endl;
+        }
+    }
+
+    // Construct a vector of command-line arguments
+    std::vector<const char *> prefix;
+    if (gate) {
+        prefix = {gate_prog, "--gate", gate->path().c_str()};
+    }
+    std::vector<std::string> size_args(files.size());
+    std::vector<const char * const *> argvs;
+    for (std::size_t i = 0U; i < files.size(); i++) {
+        const std::size_t n = prefix.size() + child_options.size() + 4U
+                              + (gate ? 1U : 0U);
+        const char **child_argv = new const char *[n];
+        const char **arg = std::copy(prefix.begin(), prefix.end(), child_argv);
+        if (gate) {
+            size_args[i] = std::to_string(sizes[i]);
+            *arg++ = size_args[i].c_str();
+        }
+        *arg++ = prog_name;
+        for (const auto &option : child_options) {
+            *arg++ = option.c_str();
+        }
+        *arg++ = files[i].c_str();
+        *arg++ = do_compact ? "y" : "n";
+        *arg = nullptr;
+        argvs.push_back(child_argv);
+    }
+
+    // Prepare the data action and perform scan
+    DataActionImpl::setSink(&sink);
+    DataActionImpl dummy;
+    quickly::ThreadPool pool(gate ? gate_prog : prog_name, argvs, &dummy,
+                             parallel);
+    pool.setVmLimit(vm_limit_mb * 1024UL * 1024UL);
+    pool.setCpuLimit(cpu_limit);
+    pool.setVerbosity(5U);
+    {
+        Telemetry::PoolScope scope(telemetry.get(), argvs.size(), parallel);
+        pool.run();
+    }
+    DataActionImpl::setSink(nullptr);
+
+    for (std::size_t i = 0U; i < argvs.size(); i++) {
+        delete[] argvs[i];
+    }
+}
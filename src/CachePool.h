@@ -0,0 +1,142 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * CachePool.h
+ */
+
+#ifndef CACHEPOOL_H_
+#define CACHEPOOL_H_
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define BOOST_FILESYSTEM_VERSION 3
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include "MemGate.h"
+#include "Telemetry.h"
+
+// Files with their sizes
+typedef std::vector<std::pair<std::uintmax_t, std::string> > sizedvector;
+
+/*!
+ * \brief Reads the next window lines of the input list, or all remaining
+ * ones if window is 0, and checks them in parallel threads.
+ *
+ * Appends the sizes and canonical paths of the regular files to
+ * sized_files, in list order, and reports the others on stderr. Returns
+ * false at the end of the list.
+ */
+bool read_window(std::istream &in, unsigned int window,
+                 sizedvector &sized_files);
+
+/*!
+ * \brief The executables run by a CachePool.
+ */
+struct CachePrograms {
+    const char *pdf2paths;
+    const char *pdf2vals;
+    const char *swf2paths;
+    // The running program, which serves as the gate of MemGate
+    const char *self;
+};
+
+/*!
+ * \brief Extracts the structural paths of input files in child processes
+ * and caches them, as cacher does, for every program that caches.
+ *
+ * The input list is read in windows of files, and the files of the next
+ * window are checked while those of the current one are processed. The
+ * files of a window are processed largest first by a single worker pool,
+ * under a MemGate if a memory budget is given.
+ */
+class CachePool {
+public:
+    /*!
+     * \brief Called with the files of a window, in list order, before
+     * they are processed.
+     */
+    typedef std::function<void(const sizedvector &)> WindowFn;
+
+    /*!
+     * \brief Called from the worker threads with the index of a file in
+     * its window and the output of its extractor, after it was cached.
+     */
+    typedef std::function<void(std::size_t, std::string &&)> Sink;
+
+    /*!
+     * \brief Returns the options of caching.
+     *
+     * @param vm_limit the name of the virtual memory limit option, as
+     * its short name differs between programs.
+     */
+    static boost::program_options::options_description options(
+            const char *vm_limit);
+
+    /*!
+     * \brief Sets up caching with the options in vm.
+     *
+     * Throws a const char * on invalid options.
+     *
+     * @param program the name of the program for the status file.
+     */
+    CachePool(const boost::program_options::variables_map &vm,
+              const char *program, const CachePrograms &programs);
+    ~CachePool();
+
+    CachePool(const CachePool &) = delete;
+    CachePool &operator=(const CachePool &) = delete;
+
+    /*!
+     * \brief Returns the cache file of an input file, given by its
+     * canonical path.
+     */
+    std::string cache_path(const std::string &file) const;
+
+    /*!
+     * \brief Caches all files in the list.
+     *
+     * @param on_window called before every window, if set.
+     * @param sink called for every cached file, if set.
+     */
+    void run(std::istream &list, const WindowFn &on_window = WindowFn(),
+             const Sink &sink = Sink());
+private:
+    boost::filesystem::path cache_dir;
+    const char *prog_name;
+    const char *gate_prog;
+    bool do_compact;
+    // Options passed on to every child process
+    std::vector<std::string> child_options;
+    unsigned int vm_limit_mb;
+    unsigned int cpu_limit;
+    unsigned int parallel;
+    unsigned int window;
+    std::unique_ptr<MemGate> gate;
+    std::unique_ptr<Telemetry> telemetry;
+
+    void run_window(sizedvector &sized_files, const Sink &sink);
+};
+
+#endif /* CACHEPOOL_H_ */
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * DocBatch.cpp
+ */
+
+#include "DocBatch.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h> // open()
+#include <sys/mman.h> // mmap(), munmap()
+#include <sys/stat.h> // fstat()
+#include <unistd.h> // close()
+
+#include <poppler/Stream.h>
+
+MappedDocument::MappedDocument(const std::string &fname) :
+        addr(MAP_FAILED), len(0U), doc(NULL) {
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw "Unable to open the file.";
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 or st.st_size <= 0) {
+        close(fd);
+        throw "Unable to map an empty or unreadable file.";
+    }
+    len = st.st_size;
+    addr = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        throw "Unable to map the file.";
+    }
+    Object dict;
+    dict.initNull();
+    // The document takes ownership of the stream, not of the buffer
+    MemStream *stream = new MemStream(static_cast<char *>(addr), 0U, len,
+                                      &dict);
+    doc = new PDFDoc(stream);
+}
+
+MappedDocument::~MappedDocument() {
+    delete doc;
+    if (addr != MAP_FAILED) {
+        munmap(addr, len);
+    }
+}
+
+void read_batch_list(const std::string &list, std::vector<std::string> &files) {
+    std::string line;
+    if (list == "-") {
+        while (std::getline(std::cin, line, '\0')) {
+            files.push_back(line);
+        }
+    } else {
+        std::ifstream in(list, std::ios::binary);
+        if (not in) {
+            throw "Unable to read the batch list.";
+        }
+        while (std::getline(in, line)) {
+            files.push_back(line);
+        }
+    }
+}
+
+void write_frame(std::ostream &out, bool ok, const std::string &fname,
+                 const std::string &payload) {
+    std::string name(fname);
+    std::replace(name.begin(), name.end(), '\n', '?');
+    out << "#%HIDOST " << (ok ? "ok" : "error") << ' ' << payload.size()
+        << ' ' << name << '\n' << payload;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * DocBatch.h
+ */
+
+#ifndef DOCBATCH_H_
+#define DOCBATCH_H_
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <poppler/PDFDoc.h>
+
+/*
+ * Support for processing many documents in a single process.
+ *
+ * In batch mode, the output of every document is written as a frame: a
+ * header line
+ *
+ *   #%HIDOST <status> <nbytes> <file name>\n
+ *
+ * followed by exactly nbytes bytes of payload. The status is "ok" and
+ * the payload the regular output of the document, or the status is
+ * "error" and the payload the error message. Newlines in file names are
+ * written as '?', so that the header stays a single line.
+ */
+
+/*!
+ * \brief A PDF document loaded from a memory-mapped file.
+ */
+class MappedDocument {
+private:
+    void *addr;
+    std::size_t len;
+    PDFDoc *doc;
+
+    MappedDocument(const MappedDocument &);
+    MappedDocument &operator=(const MappedDocument &);
+public:
+    /*!
+     * \brief Maps the file into memory and opens it as a PDF document.
+     *
+     * Throws a const char * if the file cannot be mapped.
+     */
+    explicit MappedDocument(const std::string &fname);
+    ~MappedDocument();
+
+    PDFDoc *get() {
+        return doc;
+    }
+};
+
+/*!
+ * \brief Reads the list of documents of a batch.
+ *
+ * The list file holds one file name per line. If its name is "-", file
+ * names are read from the standard input, separated by NUL characters.
+ */
+void read_batch_list(const std::string &list, std::vector<std::string> &files);
+
+/*!
+ * \brief Writes the output of a document as a frame.
+ *
+ * @param out the output stream.
+ * @param ok false if the payload is an error message.
+ * @param fname the document file name.
+ * @param payload the output of the document or the error message.
+ */
+void write_frame(std::ostream &out, bool ok, const std::string &fname,
+                 const std::string &payload);
+
+#endif /* DOCBATCH_H_ */
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * DocMetrics.cpp
+ */
+
+#include "DocMetrics.h"
+
+#include <cstdio>
+#include <cstdlib> // strtol()
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h> // open()
+#include <sys/resource.h> // getrusage()
+#include <unistd.h> // write(), close()
+
+DocMetrics::DocMetrics() :
+        file(), error(), open_ms(0.0), traversal_ms(0.0), compaction_ms(0.0),
+        objects_fetched(0UL), refs_followed(0UL), max_queue(0UL),
+        subtrees_skipped(0UL), distinct_paths(0UL), total_paths(0UL), output_bytes(0UL) {
+}
+
+double DocMetrics::elapsed_ms(const clock::time_point &start) {
+    return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+}
+
+/*
+ * Writing 5 to clear_refs resets VmHWM, the peak resident set size that
+ * /proc/self/status reports, unlike ru_maxrss.
+ */
+bool DocMetrics::reset_peak_rss() {
+    std::ofstream out("/proc/self/clear_refs");
+    out << "5";
+    out.close();
+    return static_cast<bool>(out);
+}
+
+/*
+ * Returns the peak resident set size of the current process in kB.
+ */
+static long peak_rss_kb() {
+    std::ifstream in("/proc/self/status");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0U, 6U, "VmHWM:") == 0) {
+            return std::strtol(line.c_str() + 6, nullptr, 10);
+        }
+    }
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        // Linux reports ru_maxrss in kilobytes
+        return ru.ru_maxrss;
+    }
+    return 0L;
+}
+
+/*
+ * Writes s to out as a JSON string literal.
+ */
+static void json_string(std::ostream &out, const std::string &s) {
+    out << '"';
+    for (const char c : s) {
+        if (c == '"' or c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out << buf;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+bool DocMetrics::write_json(const char *fname) const {
+    std::stringstream ss;
+    ss << "{\"file\":";
+    json_string(ss, file);
+    ss << ",\"status\":" << (error.empty() ? "\"ok\"" : "\"error\"");
+    if (not error.empty()) {
+        ss << ",\"error\":";
+        json_string(ss, error);
+    }
+    ss << ",\"open_ms\":" << open_ms
+       << ",\"traversal_ms\":" << traversal_ms
+       << ",\"compaction_ms\":" << compaction_ms
+       << ",\"objects_fetched\":" << objects_fetched
+       << ",\"refs_followed\":" << refs_followed
+       << ",\"max_queue\":" << max_queue
+       << ",\"subtrees_skipped\":" << subtrees_skipped
+       << ",\"distinct_paths\":" << distinct_paths
+       << ",\"total_paths\":" << total_paths
+       << ",\"output_bytes\":" << output_bytes
+       << ",\"peak_rss_kb\":" << peak_rss_kb() << "}\n";
+    const std::string line(ss.str());
+
+    int fd = open(fname, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd == -1) {
+        return false;
+    }
+    bool ok = write(fd, line.c_str(), line.size())
+              == static_cast<ssize_t>(line.size());
+    return close(fd) == 0 and ok;
+}
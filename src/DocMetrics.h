@@ -0,0 +1,91 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * DocMetrics.h
+ */
+
+#ifndef DOCMETRICS_H_
+#define DOCMETRICS_H_
+
+#include <chrono>
+#include <string>
+
+/*!
+ * \brief Per-document extraction metrics of pdf2paths and pdf2vals.
+ *
+ * The metrics are written as one JSON object per line, appended to a
+ * metrics file shared by all processes of a run.
+ */
+struct DocMetrics {
+    typedef std::chrono::steady_clock clock;
+
+    // The document file name
+    std::string file;
+    // Empty on success, the error message otherwise
+    std::string error;
+    // Time spent opening and parsing the document and its XRef table
+    double open_ms;
+    // Time spent traversing the document, including compaction
+    double traversal_ms;
+    // Time spent compacting paths
+    double compaction_ms;
+    // Number of objects fetched from the XRef table
+    unsigned long objects_fetched;
+    // Number of references encountered during traversal
+    unsigned long refs_followed;
+    // Maximum length of the traversal queue
+    unsigned long max_queue;
+    // Number of repeated dictionaries and streams not expanded again
+    unsigned long subtrees_skipped;
+    // Number of distinct paths in the output
+    unsigned long distinct_paths;
+    // Number of path occurrences
+    unsigned long total_paths;
+    // Number of bytes written to the standard output
+    unsigned long output_bytes;
+
+    DocMetrics();
+
+    /*!
+     * \brief Returns the number of milliseconds elapsed since start.
+     */
+    static double elapsed_ms(const clock::time_point &start);
+
+    /*!
+     * \brief Resets the peak resident set size of the current process to
+     * its current resident set size, so that the peak of the next
+     * document of a batch can be measured.
+     *
+     * @return false if the kernel does not support it.
+     */
+    static bool reset_peak_rss();
+
+    /*!
+     * \brief Appends the metrics as a JSON line to the given file.
+     *
+     * The peak resident set size of the current process since the last
+     * reset_peak_rss(), or since its start, is added to the metrics. The
+     * line is appended with a single write, so that several processes
+     * can share the file.
+     *
+     * @return false if the metrics could not be written.
+     */
+    bool write_json(const char *fname) const;
+};
+
+#endif /* DOCMETRICS_H_ */
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * FeatureTrie.cpp
+ */
+
+#include "FeatureTrie.h"
+
+#include <algorithm>
+
+#include "NPPFFile.h"
+
+const unsigned int FeatureTrie::ANY;
+
+/*
+ * Segments that compaction may delete.
+ */
+static bool deletable(const std::string &s) {
+    static const std::set<std::string> names = {
+        "Kids", "Parent", "Prev", "Next", "First", "Last", "K", "P", "V", "N"
+    };
+    return names.count(s) > 0;
+}
+
+static bool ends_with(const std::string &s, const std::string &suffix) {
+    return s.size() >= suffix.size() and
+           s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/*
+ * Segments that compaction may merge with their neighbours, e.g., with
+ * the Prev/Next/First/Last and Threads rules, which match without a
+ * preceding segment delimiter.
+ */
+static bool unpredictable(const std::string &s) {
+    for (const char *suffix : {"Threads", "Prev", "Next", "First", "Last"}) {
+        if (ends_with(s, suffix)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+FeatureTrie::FeatureTrie(const char *nppf_name) :
+        children(1U), features() {
+    for (const auto &feat : InNPPFFile(nppf_name)) {
+        features.insert(feat);
+        unsigned int node = 0U;
+        // Segments are delimited by, and the path terminated with, NULs
+        std::string::size_type begin = 0U, end;
+        while ((end = feat.find('\0', begin)) != std::string::npos
+               and end > begin) {
+            const std::string segment(feat, begin, end - begin);
+            auto it = children[node].find(segment);
+            if (it == children[node].end()) {
+                children.push_back(std::map<std::string, unsigned int>());
+                it = children[node].insert({segment,
+                                            children.size() - 1U}).first;
+            }
+            node = it->second;
+            begin = end + 1U;
+        }
+    }
+}
+
+void FeatureTrie::add_children(unsigned int node, const std::string &segment,
+                               state &to) const {
+    auto it = children[node].find(segment);
+    if (it != children[node].end()) {
+        to.push_back(it->second);
+    }
+}
+
+void FeatureTrie::advance(const state &from, const std::string &segment,
+                          state &to) const {
+    to.clear();
+    if (from.empty()) {
+        return;
+    }
+    if (from.back() == ANY or unpredictable(segment)) {
+        to.push_back(ANY);
+        return;
+    }
+    const bool del = deletable(segment);
+    for (const unsigned int node : from) {
+        add_children(node, segment, to);
+        add_children(node, "Name", to);
+        if (del) {
+            to.push_back(node);
+        }
+    }
+    std::sort(to.begin(), to.end());
+    to.erase(std::unique(to.begin(), to.end()), to.end());
+}
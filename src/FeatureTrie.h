@@ -0,0 +1,91 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * FeatureTrie.h
+ */
+
+#ifndef FEATURETRIE_H_
+#define FEATURETRIE_H_
+
+#include <climits>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief A prefix trie of selected features, for pruning the traversal
+ * of PDF documents.
+ *
+ * The trie holds the segments of the (compacted) feature paths. A raw,
+ * uncompacted path prefix is tracked as the set of trie nodes it could
+ * correspond to after compaction. Compaction only ever deletes Kids,
+ * Parent, Prev, Next, First, Last, K, P, V and N segments and replaces
+ * segments with "Name", so a raw segment may either match itself or
+ * "Name", and one of these deletable segments may also vanish. An empty
+ * set means that no path with this prefix can compact to a feature.
+ *
+ * Segments for which this reasoning does not hold, i.e., the ones ending
+ * in Threads, Prev, Next, First or Last, make every continuation of the
+ * prefix possible.
+ */
+class FeatureTrie {
+public:
+    // Sorted trie node indices
+    typedef std::vector<unsigned int> state;
+private:
+    // A node standing for any continuation
+    static const unsigned int ANY = UINT_MAX;
+
+    std::vector<std::map<std::string, unsigned int> > children;
+    std::set<std::string> features;
+
+    void add_children(unsigned int node, const std::string &segment,
+                      state &to) const;
+public:
+    /*!
+     * \brief Builds the trie of the features in an NPPF file.
+     */
+    explicit FeatureTrie(const char *nppf_name);
+
+    /*!
+     * \brief Returns the state of the empty path.
+     */
+    state root() const {
+        return state(1U, 0U);
+    }
+
+    /*!
+     * \brief Computes the state of a path extended by a raw segment.
+     *
+     * @param from the state of the path.
+     * @param segment the raw segment.
+     * @param to the resulting state, empty if no feature can follow.
+     */
+    void advance(const state &from, const std::string &segment,
+                 state &to) const;
+
+    /*!
+     * \brief Returns true if the path string is a feature.
+     */
+    bool contains(const std::string &pathstr) const {
+        return features.count(pathstr) > 0;
+    }
+};
+
+#endif /* FEATURETRIE_H_ */
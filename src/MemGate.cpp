@@ -0,0 +1,272 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * MemGate.cpp
+ */
+
+#include "MemGate.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal> // raise(), signal()
+#include <cstdlib> // strtoull()
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h> // O_CLOEXEC
+#include <poll.h>
+#include <sys/prctl.h> // prctl()
+#include <sys/resource.h> // struct rusage
+#include <sys/socket.h>
+#include <sys/un.h> // struct sockaddr_un
+#include <sys/wait.h> // wait4()
+#include <unistd.h>
+
+static const double MB = 1024.0 * 1024.0;
+// The smallest input size in bytes whose memory use refines the estimate.
+// The memory use of smaller files is mostly mem_base and its noise.
+static const std::uintmax_t MIN_SAMPLE = 1024U * 1024U;
+
+/*
+ * Sends all of s, without raising SIGPIPE if the peer is gone. Returns
+ * false on errors.
+ */
+static bool send_all(int fd, const std::string &s) {
+    std::size_t sent = 0U;
+    while (sent < s.size()) {
+        const ssize_t n = send(fd, s.data() + sent, s.size() - sent,
+                               MSG_NOSIGNAL);
+        if (n < 0 and errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+MemGate::MemGate(unsigned int budget_mb, unsigned int mem_base,
+                 double mem_factor) :
+        budget(budget_mb), mem_base(mem_base), dir(), socket_path(),
+        listen_fd(-1), stop_pipe{-1, -1}, mutex(), mem_factor(mem_factor),
+        sum_excess(0.0), sum_input(0.0), clients(), waiting(), in_use(0.0),
+        running(0U), server() {
+    char tmpl[] = "/tmp/hidostXXXXXX";
+    if (mkdtemp(tmpl) == nullptr) {
+        throw "Unable to create a directory for the memory gate.";
+    }
+    dir = tmpl;
+    socket_path = dir + "/gate";
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(),
+                 sizeof(addr.sun_path) - 1U);
+    // Neither the gates nor the extractors may inherit the descriptors
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0
+        or bind(listen_fd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)) != 0
+        or listen(listen_fd, SOMAXCONN) != 0
+        or pipe2(stop_pipe, O_CLOEXEC) != 0) {
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+        unlink(socket_path.c_str());
+        rmdir(dir.c_str());
+        throw "Unable to create the socket of the memory gate.";
+    }
+    server = boost::thread(&MemGate::serve, this);
+}
+
+MemGate::~MemGate() {
+    const char c = 0;
+    while (write(stop_pipe[1], &c, 1) < 0 and errno == EINTR) {
+    }
+    server.join();
+    for (const auto &client : clients) {
+        close(client.fd);
+    }
+    close(listen_fd);
+    close(stop_pipe[0]);
+    close(stop_pipe[1]);
+    unlink(socket_path.c_str());
+    rmdir(dir.c_str());
+}
+
+double MemGate::estimate(std::uintmax_t size) const {
+    boost::mutex::scoped_lock lock(mutex);
+    return std::max(mem_base + mem_factor * size / MB, 1.0);
+}
+
+/*
+ * Handles a line from a client: its input size first, the peak resident
+ * set size of its extractor in kB after it exited. Returns false on
+ * malformed lines.
+ */
+bool MemGate::handle_line(std::list<Client>::iterator client,
+                          const std::string &line) {
+    char *end;
+    const unsigned long long value = std::strtoull(line.c_str(), &end, 10);
+    if (line.empty() or *end != '\0') {
+        return false;
+    }
+    if (not client->requested) {
+        client->size = value;
+        client->requested = true;
+        waiting.push_back(client);
+    } else if (client->size >= MIN_SAMPLE) {
+        boost::mutex::scoped_lock lock(mutex);
+        sum_excess += std::max(value / 1024.0 - mem_base, 0.0);
+        sum_input += client->size / MB;
+        mem_factor = sum_excess / sum_input;
+    }
+    return true;
+}
+
+/*
+ * Grants memory to the waiting clients in order, as long as it fits.
+ */
+void MemGate::grant() {
+    while (not waiting.empty()) {
+        const auto client = waiting.front();
+        const double need = estimate(client->size);
+        if (running > 0U and in_use + need > budget) {
+            break;
+        }
+        waiting.pop_front();
+        // A client that is gone is released once its EOF is read
+        send_all(client->fd, "1");
+        client->granted = need;
+        in_use += need;
+        running++;
+    }
+}
+
+void MemGate::serve() {
+    std::vector<struct pollfd> fds;
+    for (;;) {
+        fds.clear();
+        fds.push_back({stop_pipe[0], POLLIN, 0});
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (const auto &client : clients) {
+            fds.push_back({client.fd, POLLIN, 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "The memory gate failed, no longer starting "
+                         "child processes." << std::endl;
+            return;
+        }
+        if (fds[0].revents != 0) {
+            return;
+        }
+
+        // Clients accepted now are appended after the polled ones
+        auto it = clients.begin();
+        if (fds[1].revents & POLLIN) {
+            const int fd = accept4(listen_fd, nullptr, nullptr,
+                                   SOCK_CLOEXEC);
+            if (fd >= 0) {
+                clients.push_back({fd, std::string(), 0U, false, 0.0});
+            }
+        }
+        for (std::size_t i = 2U; i < fds.size(); i++) {
+            const auto client = it++;
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            char buf[256];
+            const ssize_t n = read(client->fd, buf, sizeof(buf));
+            bool keep = n > 0 or (n < 0 and errno == EINTR);
+            if (n > 0) {
+                client->buf.append(buf, n);
+                std::string::size_type pos;
+                while (keep
+                       and (pos = client->buf.find('\n')) != std::string::npos) {
+                    keep = handle_line(client, client->buf.substr(0U, pos));
+                    client->buf.erase(0U, pos + 1U);
+                }
+            }
+            if (not keep) {
+                // The gate has exited, so its extractor has too
+                if (client->granted > 0.0) {
+                    in_use = running > 1U ? in_use - client->granted : 0.0;
+                    running--;
+                }
+                waiting.remove(client);
+                close(client->fd);
+                clients.erase(client);
+            }
+        }
+        grant();
+    }
+}
+
+int MemGate::gate_main(int argc, char *argv[]) {
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0] << " --gate <socket> <input size> "
+                     "<extractor> [<argument>...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, argv[2], sizeof(addr.sun_path) - 1U);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    char c;
+    if (fd < 0
+        or connect(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                   sizeof(addr)) != 0
+        or not send_all(fd, std::string(argv[3]) + '\n')
+        or recv(fd, &c, 1, 0) != 1) {
+        std::cerr << "Unable to get memory from the memory gate."
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Unable to start " << argv[4] << std::endl;
+        return EXIT_FAILURE;
+    } else if (pid == 0) {
+        // Do not outlive the gate, which holds the memory
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        execv(argv[4], argv + 4);
+        _exit(127);
+    }
+    int status;
+    struct rusage ru;
+    while (wait4(pid, &status, 0, &ru) < 0) {
+        if (errno != EINTR) {
+            return EXIT_FAILURE;
+        }
+    }
+    // Linux reports ru_maxrss in kilobytes
+    send_all(fd, std::to_string(ru.ru_maxrss) + '\n');
+    close(fd);
+    if (WIFSIGNALED(status)) {
+        std::signal(WTERMSIG(status), SIG_DFL);
+        std::raise(WTERMSIG(status));
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+}
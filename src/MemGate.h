@@ -0,0 +1,135 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * MemGate.h
+ */
+
+#ifndef MEMGATE_H_
+#define MEMGATE_H_
+
+#include <cstdint>
+#include <list>
+#include <string>
+
+#include <boost/thread.hpp>
+
+/*!
+ * \brief Lets the child processes of a quickly::ThreadPool start only
+ * while their estimated memory use fits a budget.
+ *
+ * quickly::ThreadPool starts its jobs as soon as a worker is free, so the
+ * gate sits between the pool and the extractor: the pool runs the program
+ * itself with --gate (see gate_main()), which asks the MemGate of its
+ * parent process over a Unix domain socket for the memory of its input
+ * file and waits until it is granted. It then runs the extractor as its
+ * own child process and reports the peak resident set size of the
+ * extractor when it exits. The memory is released when the connection
+ * is closed, so that jobs killed by their resource limits release it
+ * too.
+ *
+ * Requests are granted in the order they arrive, which is the order of
+ * the jobs in the pool. A job whose estimate exceeds the whole budget
+ * runs once no other job holds memory.
+ *
+ * The estimate of a job is mem_base MB plus mem_factor MB per MB of
+ * input. mem_factor starts at the given value and is then replaced by
+ * the average observed over all finished extractors of inputs of at
+ * least 1 MB, weighted by the sizes of their input files.
+ */
+class MemGate {
+private:
+    // A connected gate
+    struct Client {
+        int fd;
+        std::string buf;
+        // The input file size in bytes, once requested
+        std::uintmax_t size;
+        bool requested;
+        // The memory granted in MB, if any
+        double granted;
+    };
+
+    const double budget;
+    const double mem_base;
+    std::string dir;
+    std::string socket_path;
+    int listen_fd;
+    // Written to by the destructor to stop the server thread
+    int stop_pipe[2];
+
+    mutable boost::mutex mutex;
+    double mem_factor;
+    // Sums over the finished extractors of the memory used beyond
+    // mem_base and of the input sizes, in MB
+    double sum_excess;
+    double sum_input;
+
+    std::list<Client> clients;
+    // Clients waiting for memory, in the order of their requests
+    std::list<std::list<Client>::iterator> waiting;
+    // The memory granted to the running extractors in MB, and their number
+    double in_use;
+    unsigned int running;
+    boost::thread server;
+
+    void serve();
+    bool handle_line(std::list<Client>::iterator client,
+                     const std::string &line);
+    void grant();
+public:
+    /*!
+     * \brief Starts serving gates.
+     *
+     * Throws a const char * if the socket cannot be created.
+     *
+     * @param budget_mb the memory budget of all extractors in MB.
+     * @param mem_base the estimated memory use of an extractor in MB,
+     * regardless of its input.
+     * @param mem_factor the initial estimate of the memory use in MB per
+     * MB of input.
+     */
+    MemGate(unsigned int budget_mb, unsigned int mem_base, double mem_factor);
+    ~MemGate();
+
+    MemGate(const MemGate &) = delete;
+    MemGate &operator=(const MemGate &) = delete;
+
+    /*!
+     * \brief Returns the path of the socket, to pass to gate_main().
+     */
+    const std::string &path() const {
+        return socket_path;
+    }
+
+    /*!
+     * \brief Returns the current estimate of the memory use in MB of an
+     * extractor with the given input size, at least 1 MB.
+     */
+    double estimate(std::uintmax_t size) const;
+
+    /*!
+     * \brief The main function of a gate, run as
+     * <program> --gate <socket> <input size> <extractor> [<argument>...]
+     *
+     * Returns the exit status of the extractor. If the extractor was
+     * killed by a signal, the gate kills itself with the same signal.
+     */
+    static int gate_main(int argc, char *argv[]);
+};
+
+#endif /* MEMGATE_H_ */
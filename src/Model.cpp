@@ -0,0 +1,193 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Model.cpp
+ */
+
+#include "Model.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+/*
+ * Returns the value of a feature of a sparse vector, 0 if it is missing.
+ */
+static double feature_value(const sparsevector &v, unsigned int feature) {
+    const sparsevector::const_iterator it = std::lower_bound(
+            v.begin(), v.end(), feature,
+            [](const std::pair<unsigned int, double> &f, unsigned int index) {
+                return f.first < index;
+            });
+    return (it != v.end() and it->first == feature) ? it->second : 0.0;
+}
+
+/*
+ * Reads the next line which is neither empty nor a comment. Returns
+ * false at the end of the file.
+ */
+static bool next_line(std::istream &in, std::string &line) {
+    while (std::getline(in, line)) {
+        if (not line.empty() and line[0] != '#') {
+            return true;
+        }
+    }
+    return false;
+}
+
+Model::Model(const char *fname) :
+        linear(true), bias(0.0), weights(), nodes(), roots(), nweights(0U) {
+    std::ifstream in(fname);
+    if (not in.is_open()) {
+        throw "Unable to open the model file.";
+    }
+    std::string line;
+    if (not next_line(in, line)) {
+        throw "The model file is empty.";
+    }
+    std::istringstream kind(line);
+    std::string word;
+    kind >> word;
+    if (word == "trees") {
+        linear = false;
+    } else if (word != "linear") {
+        throw "Unknown model kind, expected \"linear\" or \"trees\".";
+    }
+
+    // The index of the first node of the current tree
+    unsigned int tree_start = 0U;
+    bool first = true;
+    while (next_line(in, line)) {
+        std::istringstream fields(line);
+        fields >> word;
+        if (first and word == "bias") {
+            if (not (fields >> bias)) {
+                throw "Malformed bias in the model file.";
+            }
+        } else if (linear) {
+            parse_weight(line);
+        } else if (word == "tree") {
+            if (not roots.empty()) {
+                check_tree(tree_start);
+            }
+            tree_start = nodes.size();
+            roots.push_back(tree_start);
+        } else if (roots.empty()) {
+            throw "Tree node outside of a tree in the model file.";
+        } else {
+            parse_node(line, tree_start);
+        }
+        first = false;
+    }
+    if (not roots.empty()) {
+        check_tree(tree_start);
+    }
+}
+
+void Model::parse_weight(const std::string &line) {
+    std::istringstream fields(line);
+    unsigned int index;
+    double weight;
+    if (not (fields >> index >> weight) or index == 0U) {
+        throw "Malformed weight in the model file.";
+    }
+    if (index >= weights.size()) {
+        weights.resize(index + 1U, 0.0);
+    }
+    weights[index] = weight;
+    nweights++;
+}
+
+void Model::parse_node(const std::string &line, unsigned int tree_start) {
+    std::istringstream fields(line);
+    std::string type;
+    fields >> type;
+    // The number of the node within its tree
+    const unsigned int number = nodes.size() - tree_start;
+    Node node{0U, 0.0, 0U, 0U};
+    if (type == "leaf") {
+        if (not (fields >> node.value)) {
+            throw "Malformed leaf in the model file.";
+        }
+    } else if (type == "split") {
+        if (not (fields >> node.feature >> node.value >> node.left
+                 >> node.right) or node.feature == 0U) {
+            throw "Malformed split in the model file.";
+        }
+        if (node.left <= number or node.right <= number) {
+            throw "Tree node children must follow their parent in the "
+                  "model file.";
+        }
+        node.left += tree_start;
+        node.right += tree_start;
+    } else {
+        throw "Unknown tree node type in the model file.";
+    }
+    nodes.push_back(node);
+}
+
+/*
+ * Checks that the tree starting at tree_start is complete.
+ */
+void Model::check_tree(unsigned int tree_start) const {
+    if (tree_start == nodes.size()) {
+        throw "Empty tree in the model file.";
+    }
+    for (unsigned int i = tree_start; i < nodes.size(); i++) {
+        if (nodes[i].feature != 0U and (nodes[i].left >= nodes.size()
+                                        or nodes[i].right >= nodes.size())) {
+            throw "Missing tree node in the model file.";
+        }
+    }
+}
+
+double Model::score(const sparsevector &v) const {
+    double s = bias;
+    if (linear) {
+        for (const auto &f : v) {
+            if (f.first < weights.size()) {
+                s += weights[f.first] * f.second;
+            }
+        }
+        return s;
+    }
+    for (const unsigned int root : roots) {
+        unsigned int i = root;
+        while (nodes[i].feature != 0U) {
+            const Node &n = nodes[i];
+            i = feature_value(v, n.feature) < n.value ? n.left : n.right;
+        }
+        s += nodes[i].value;
+    }
+    return s;
+}
+
+void write_output_line(std::ostream &out, bool malicious, sparsevector &v,
+                       bool use_values, const Model *model,
+                       const std::string &fname) {
+    if (model == nullptr) {
+        write_libsvm_line(out, malicious, v, use_values, fname);
+        return;
+    }
+    if (not use_values) {
+        for (auto &feat : v) {
+            feat.second = 1.0;
+        }
+    }
+    out << malicious << ' ' << model->score(v) << " #" << fname;
+}
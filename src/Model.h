@@ -0,0 +1,136 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Model.h
+ */
+
+#ifndef MODEL_H_
+#define MODEL_H_
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "featmatch.h"
+
+/*!
+ * \brief A trained classifier which scores feature vectors.
+ *
+ * A model is a text file. Empty lines and lines starting with '#' are
+ * ignored. The first line holds the kind of the model, "linear" or
+ * "trees", and may be followed by a line "bias <b>" (default 0).
+ *
+ * The other lines of a linear model hold a feature index and its weight:
+ *
+ *   linear
+ *   bias -0.5
+ *   3 0.25
+ *   17 -1.5
+ *
+ * Its score is the bias plus the sum of the weights times the values of
+ * the features. Features without a weight have the weight 0.
+ *
+ * A tree ensemble lists its trees, each starting with a line "tree",
+ * followed by its nodes, the root first:
+ *
+ *   trees
+ *   tree
+ *   split 3 0.5 1 2
+ *   leaf -0.2
+ *   leaf 0.7
+ *
+ * "split <feature> <threshold> <left> <right>" continues with the node
+ * left if the value of the feature is less than the threshold, and with
+ * the node right otherwise. Nodes are numbered from 0 within their tree
+ * and children must follow their parents. "leaf <value>" ends the walk.
+ * The score is the bias plus the sum of the leaf values of all trees.
+ *
+ * Features missing from a sparse vector have the value 0 in both kinds.
+ */
+class Model {
+private:
+    /*
+     * A node of a tree. Leaves have the feature 0. The children are
+     * indices into nodes.
+     */
+    struct Node {
+        unsigned int feature;
+        // The threshold of a split or the value of a leaf
+        double value;
+        unsigned int left;
+        unsigned int right;
+    };
+
+    bool linear;
+    double bias;
+    // Weights by feature index, index 0 is unused
+    std::vector<double> weights;
+    // The nodes of all trees
+    std::vector<Node> nodes;
+    // The indices of the roots of the trees in nodes
+    std::vector<unsigned int> roots;
+    // Number of weights of a linear model
+    std::size_t nweights;
+
+    void parse_weight(const std::string &line);
+    void parse_node(const std::string &line, unsigned int tree_start);
+    void check_tree(unsigned int tree_start) const;
+public:
+    /*!
+     * \brief Loads a model from a file.
+     */
+    explicit Model(const char *fname);
+
+    /*!
+     * \brief Returns the score of a feature vector.
+     */
+    double score(const sparsevector &v) const;
+
+    bool is_linear() const {
+        return linear;
+    }
+
+    /*!
+     * \brief Returns the number of weights or trees.
+     */
+    std::size_t size() const {
+        return linear ? nweights : roots.size();
+    }
+};
+
+/*!
+ * \brief Writes the output line of a file, its feature vector in libsvm
+ * format or, given a model, its score.
+ *
+ * A score line has the form "<class> <score> #<file name>", i.e., that of
+ * a libsvm line with the score in place of the features. Without values,
+ * every feature has the value 1, also for the model, so v may change.
+ *
+ * @param out the output stream.
+ * @param malicious the class of the file.
+ * @param v the feature vector.
+ * @param use_values whether to use the values of the features.
+ * @param model the model, or nullptr to write the vector.
+ * @param fname the name of the file.
+ */
+void write_output_line(std::ostream &out, bool malicious, sparsevector &v,
+                       bool use_values, const Model *model,
+                       const std::string &fname);
+
+#endif /* MODEL_H_ */
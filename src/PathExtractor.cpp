@@ -0,0 +1,499 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * PathExtractor.cpp
+ */
+
+#include "PathExtractor.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <utility>
+
+#include <poppler/GlobalParams.h>
+
+#include "DocBatch.h"
+#include "RefSet.h"
+#include "trace.h"
+
+namespace po = boost::program_options;
+
+/*
+ * Converts the value of a primitive object to double.
+ */
+static double objValue(Object &o) {
+    if (o.isBool()) {
+        return o.getBool() ? 1.0 : 0.0;
+    } else if (o.isNum()) {
+        return o.getNum();
+    } else {
+        // Path presence by default
+        return 1.0;
+    }
+}
+
+PathExtractor::PathExtractor(const char *prog_name) :
+        prog_name(prog_name), sink(nullptr), want_values(false),
+        do_compact(false), do_dedup(false), features(nullptr), expanded(),
+        xref(nullptr), metrics(), metrics_file(), values() {
+}
+
+PathExtractor::~PathExtractor() {
+    delete features;
+}
+
+void PathExtractor::exit_error(const char *e) {
+    std::cerr << prog_name << ": " << e << std::endl;
+    if (not metrics_file.empty()) {
+        metrics.error = e;
+        metrics.write_json(metrics_file.c_str());
+    }
+    std::exit(EXIT_FAILURE);
+}
+
+/*
+ * Converts a path to a string, compacting it if requested. Compaction is
+ * only timed if the metrics are written, to keep the clock out of the
+ * hot path otherwise.
+ */
+std::string PathExtractor::pathString(const pdfpath &path) {
+    if (not do_compact) {
+        return pdfpath_to_string(path);
+    }
+    if (metrics_file.empty()) {
+        return compact_pdfpath(path);
+    }
+    const DocMetrics::clock::time_point start(DocMetrics::clock::now());
+    std::string pathstr(compact_pdfpath(path));
+    metrics.compaction_ms += DocMetrics::elapsed_ms(start);
+    return pathstr;
+}
+
+/*
+ * Adds n occurrences of a path, e.g., all primitive elements of an array,
+ * with a single compaction and table lookup.
+ */
+void PathExtractor::printPath(const pdfpath &path, unsigned int n,
+                              const double *vals) {
+    const std::string pathstr(pathString(path));
+    if (pathstr.size() < 2) {
+        // Remove empty paths (consisting of 2 null-bytes)
+        return;
+    }
+    if (features != nullptr and not features->contains(pathstr)) {
+        return;
+    }
+    HIDOST_TRACE3(path_emit, pathstr.data(), pathstr.size(), n);
+    metrics.total_paths += n;
+    sink->add(pathstr, n, vals);
+}
+
+/*
+ * Adds a single occurrence of a path with the value of an object.
+ */
+void PathExtractor::printPath(const pdfpath &path, Object &o) {
+    const double val = want_values ? objValue(o) : 1.0;
+    printPath(path, 1U, want_values ? &val : nullptr);
+}
+
+/*
+ * Queues the value of a dictionary or stream entry with the given key,
+ * unless no feature can be found below it.
+ */
+void PathExtractor::push_child(std::queue<bfsnode> &unvisited, Object *op,
+                               bfsnode &parent, const std::string &key) {
+    FeatureTrie::state state;
+    if (features != nullptr) {
+        features->advance(parent.state, key, state);
+        if (state.empty()) {
+            delete op;
+            return;
+        }
+    }
+    parent.path.push_back(key);
+    unvisited.push(bfsnode{op, parent.path, state});
+    parent.path.pop_back();
+}
+
+/*
+ * Queues the entries of a dictionary or stream, sorted by key. The kind
+ * tells dictionaries ('D') and streams ('S') apart.
+ *
+ * With deduplication, the (compacted) path of the node is combined
+ * with its shape: its kind and its keys with the types of their values.
+ * If a node with the same path and shape has already been expanded,
+ * only its entries with simple values are queued. The paths of its
+ * references are output as in a full traversal, but its dictionaries,
+ * streams, arrays and references are not traversed again.
+ */
+void PathExtractor::push_entries(std::queue<bfsnode> &unvisited,
+                                 bfsnode &node, Dict *d, char kind) {
+    typedef std::map<std::string, int> keymap;
+    static const std::string noname("<nn>");
+    keymap keys;
+    // Sort keys
+    for (int i = 0; i < d->getLength(); i++) {
+        keys.insert({d->getKey(i), i});
+    }
+    std::vector<Object *> entries;
+    entries.reserve(keys.size());
+    for (const auto &key : keys) {
+        Object *op = new Object();
+        d->getValNF(key.second, op);
+        entries.push_back(op);
+    }
+
+    bool repeated = false;
+    if (do_dedup) {
+        std::string shape(pathString(node.path));
+        shape += kind;
+        std::vector<Object *>::size_type i = 0U;
+        for (const auto &key : keys) {
+            shape += key.first;
+            shape += '\0';
+            shape += static_cast<char>('a' + entries[i++]->getType());
+        }
+        repeated = not expanded.insert(shape).second;
+        if (repeated) {
+            metrics.subtrees_skipped++;
+        }
+    }
+
+    std::vector<Object *>::iterator it = entries.begin();
+    for (const auto &key : keys) {
+        Object *op = *it++;
+        const std::string &name = key.first.size() ? key.first : noname;
+        if (not repeated or not (op->isDict() or op->isStream()
+                                 or op->isArray() or op->isRef())) {
+            push_child(unvisited, op, node, name);
+            continue;
+        }
+        if (op->isRef()) {
+            node.path.push_back(name);
+            printPath(node.path, *op);
+            node.path.pop_back();
+        }
+        delete op;
+    }
+}
+
+void PathExtractor::bfs() {
+    Object *root = new Object();
+    xref->getCatalog(root);
+    if (root->isNull()) {
+        delete root;
+        throw "Malformed Catalog dictionary.";
+    }
+    std::queue<bfsnode> unvisited;
+    unvisited.push(bfsnode{root, pdfpath(), features != nullptr ?
+            features->root() : FeatureTrie::state()});
+    // References already followed
+    RefSet visitedRefs(xref->getNumObjects());
+
+    while (unvisited.size() > 0) {
+        if (unvisited.size() > metrics.max_queue) {
+            metrics.max_queue = unvisited.size();
+        }
+        bfsnode node(std::move(unvisited.front()));
+        Object *o = node.obj;
+        pdfpath &path = node.path;
+
+        switch (o->getType()) {
+        case objArray: {
+            Array *a = o->getArray();
+            // Primitive elements all have the path of the array
+            unsigned int primitives = 0U;
+            values.clear();
+            for (int i = 0; i < a->getLength(); i++) {
+                Object *op = new Object();
+                a->getNF(i, op);
+                switch (op->getType()) {
+                case objDict:
+                case objStream:
+                case objArray:
+                case objRef:
+                    unvisited.push(bfsnode{op, path, node.state});
+                    break;
+                case objEOF:
+                case objError:
+                case objNone:
+                case objCmd:
+                    std::cerr << prog_name << ": Unexpected error in array.\n";
+                    break;
+                default:
+                    // A simple PDF type or objUint
+                    primitives++;
+                    if (want_values) {
+                        values.push_back(objValue(*op));
+                    }
+                    delete op;
+                }
+            }
+            if (primitives > 0U) {
+                printPath(path, primitives,
+                          want_values ? values.data() : nullptr);
+            }
+            if (a->getLength() == 0) {
+                // Empty array
+                printPath(path, *o);
+            }
+        }
+            break;
+        case objDict: {
+            Dict *d = o->getDict();
+            push_entries(unvisited, node, d, 'D');
+            if (d->getLength() == 0) {
+                // Empty dict
+                printPath(path, *o);
+            }
+        }
+            break;
+        case objStream: {
+            Dict *d = o->getStream()->getDict();
+            push_entries(unvisited, node, d, 'S');
+            if (d->getLength() == 0) {
+                // Empty stream
+                printPath(path, *o);
+            }
+        }
+            break;
+        case objRef: {
+            Ref r = o->getRef();
+            metrics.refs_followed++;
+            if (visitedRefs.insert(r)) {
+                Object *op = new Object();
+                HIDOST_TRACE2(object_fetch, r.num, r.gen);
+                xref->fetch(r.num, r.gen, op);
+                metrics.objects_fetched++;
+                unvisited.push(bfsnode{op, path, node.state});
+            }
+            printPath(path, *o);
+        }
+            break;
+        case objError:
+            std::cerr << prog_name << ": objError\n";
+            break;
+        case objEOF:
+            std::cerr << prog_name << ": objEOF\n";
+            break;
+        case objNone:
+            std::cerr << prog_name << ": objNone\n";
+            break;
+        case objCmd:
+            std::cerr << prog_name << ": objCmd\n";
+            break;
+        default:
+            // Simple type or objUint
+            printPath(path, *o);
+            break;
+        }
+        delete o;
+        unvisited.pop();
+    }
+}
+
+po::variables_map PathExtractor::parse_arguments(
+        int argc, char *argv[], const std::string &what,
+        const po::options_description &extra) {
+    po::options_description desc(
+            "Usage: " + prog_name + " [options] file_name (y|n)\n"
+            "       " + prog_name + " [options] --batch list (y|n)\n"
+            "This program extracts and prints " + what + " from the "
+            "given PDF file, compacting them if the last argument is 'y'. "
+            "Allowed options");
+    desc.add_options()
+            ("help", "produce help message")
+            ("metrics",
+                    po::value<std::string>(),
+                    "append per-document metrics as a JSON line to this file")
+            ("features",
+                    po::value<std::string>(),
+                    "only extract the paths in this NPPF feature file; "
+                    "branches of the document that cannot lead to one of "
+                    "them are not traversed, so objects also reachable "
+                    "from them may be expanded under a different path "
+                    "than in a full traversal")
+            ("dedup",
+                    "do not expand a dictionary or stream again if one with "
+                    "the same (compacted) path, keys and value types has "
+                    "already been expanded; only its entries with simple "
+                    "values and its references are output, so paths and "
+                    "counts below it may be missing")
+            ("batch",
+                    po::value<std::string>(),
+                    "process all files of a list, one per line, or of "
+                    "NUL-separated names on the standard input if the list "
+                    "is '-'; the output of every file is written as a frame "
+                    "starting with a line '#%HIDOST <ok|error> <nbytes> "
+                    "<file name>'");
+    if (not extra.options().empty()) {
+        desc.add(extra);
+    }
+    po::options_description hidden;
+    hidden.add_options()
+            ("args", po::value<std::vector<std::string> >(), "");
+    po::options_description all;
+    all.add(desc).add(hidden);
+    po::positional_options_description pos;
+    pos.add("args", -1);
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).options(all)
+                          .positional(pos).run(), vm);
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            std::exit(EXIT_SUCCESS);
+        }
+        po::notify(vm);
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl << std::endl << desc << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return vm;
+}
+
+/*
+ * Extracts the structural paths of a document whose loading started at
+ * the given time and returns the output of the sink. Throws a const
+ * char * on errors.
+ */
+std::string PathExtractor::extract(PDFDoc *pdfdoc,
+                                   const DocMetrics::clock::time_point &start) {
+    if (!pdfdoc->isOk()) {
+        throw "Error in the PDF document.";
+    }
+
+    xref = pdfdoc->getXRef();
+    if (!xref->isOk()) {
+        throw "Error getting XRef.";
+    }
+    metrics.open_ms = DocMetrics::elapsed_ms(start);
+    HIDOST_TRACE1(doc_opened, xref->getNumObjects());
+
+    const DocMetrics::clock::time_point bfs_start(DocMetrics::clock::now());
+    bfs();
+    metrics.traversal_ms = DocMetrics::elapsed_ms(bfs_start);
+    HIDOST_TRACE2(traversal_done, metrics.objects_fetched, metrics.total_paths);
+
+    // All paths sorted
+    const std::string buf(sink->format());
+    metrics.distinct_paths = sink->size();
+    metrics.output_bytes = buf.size();
+    return buf;
+}
+
+void PathExtractor::write_metrics() {
+    if (not metrics_file.empty() and
+            not metrics.write_json(metrics_file.c_str())) {
+        std::cerr << prog_name << ": Unable to write metrics." << std::endl;
+    }
+}
+
+/*
+ * Processes every document of a batch, writing its output in a frame.
+ * Errors only fail the frame of their document.
+ */
+void PathExtractor::run_batch(const std::string &list) {
+    std::vector<std::string> files;
+    read_batch_list(list, files);
+    for (const auto &file : files) {
+        // Reset the per-document state
+        metrics = DocMetrics();
+        if (not metrics_file.empty()) {
+            DocMetrics::reset_peak_rss();
+        }
+        metrics.file = file;
+        expanded.clear();
+        sink->clear();
+        std::string payload;
+        bool ok = true;
+        try {
+            const DocMetrics::clock::time_point start(DocMetrics::clock::now());
+            HIDOST_TRACE1(doc_open, file.c_str());
+            MappedDocument doc(file);
+            payload = extract(doc.get(), start);
+        } catch (const char *e) {
+            ok = false;
+            payload = e;
+            metrics.error = e;
+        }
+        HIDOST_TRACE1(output_write, payload.size());
+        write_frame(std::cout, ok, file, payload);
+        write_metrics();
+    }
+    std::cout << std::flush;
+}
+
+int PathExtractor::run(const po::variables_map &vm, PathSink &sink) {
+    this->sink = &sink;
+    want_values = sink.wantsValues();
+    const bool BATCH = vm.count("batch") > 0;
+    const std::vector<std::string> ARGS = vm.count("args") ?
+            vm["args"].as<std::vector<std::string> >() :
+            std::vector<std::string>();
+    if (vm.count("metrics")) {
+        metrics_file = vm["metrics"].as<std::string>();
+    }
+    if (ARGS.size() != (BATCH ? 1U : 2U)) {
+        exit_error("Wrong count of arguments, see --help.");
+    }
+    const std::string COMPACT = ARGS.back();
+    if (strncmp(COMPACT.c_str(), "y", 1) == 0) {
+        do_compact = true;
+    } else if (strncmp(COMPACT.c_str(), "n", 1) == 0) {
+        do_compact = false;
+    } else {
+        exit_error("Last argument must be 'y' or 'n'.");
+    }
+
+    do_dedup = vm.count("dedup") > 0;
+    if (vm.count("features")) {
+        try {
+            features = new FeatureTrie(vm["features"].as<std::string>().c_str());
+        } catch (const char *e) {
+            exit_error(e);
+        }
+    }
+    globalParams = new GlobalParams();
+    if (BATCH) {
+        try {
+            run_batch(vm["batch"].as<std::string>());
+        } catch (const char *e) {
+            exit_error(e);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    const std::string INPUT_FILE = ARGS[0];
+    metrics.file = INPUT_FILE;
+    try {
+        const DocMetrics::clock::time_point start(DocMetrics::clock::now());
+        HIDOST_TRACE1(doc_open, INPUT_FILE.c_str());
+        PDFDoc *pdfdoc = new PDFDoc(new GooString(INPUT_FILE.c_str()));
+        const std::string output(extract(pdfdoc, start));
+        HIDOST_TRACE1(output_write, output.size());
+        std::cout << output << std::flush;
+    } catch (const char *e) {
+        exit_error(e);
+    }
+    write_metrics();
+    return EXIT_SUCCESS;
+}
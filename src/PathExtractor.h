@@ -0,0 +1,165 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * PathExtractor.h
+ */
+
+#ifndef PATHEXTRACTOR_H_
+#define PATHEXTRACTOR_H_
+
+#include <cstddef>
+#include <queue>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <poppler/PDFDoc.h>
+
+#include "DocMetrics.h"
+#include "FeatureTrie.h"
+#include "pdfpath.h"
+
+/*!
+ * \brief Collects the paths of a document found by a PathExtractor.
+ *
+ * The sink is all that pdf2paths and pdf2vals do differently: the former
+ * counts the paths, the latter aggregates their values.
+ */
+class PathSink {
+public:
+    virtual ~PathSink() {
+    }
+
+    /*!
+     * \brief Returns true if add() takes the values of the paths.
+     */
+    virtual bool wantsValues() const = 0;
+
+    /*!
+     * \brief Adds n occurrences of a path.
+     *
+     * @param pathstr the path string.
+     * @param n the number of occurrences.
+     * @param values the values of the occurrences, or nullptr unless
+     * wantsValues().
+     */
+    virtual void add(const std::string &pathstr, unsigned int n,
+                     const double *values) = 0;
+
+    /*!
+     * \brief Returns the number of distinct paths.
+     */
+    virtual std::size_t size() const = 0;
+
+    /*!
+     * \brief Returns the output of all paths, sorted.
+     */
+    virtual std::string format() = 0;
+
+    /*!
+     * \brief Removes all paths.
+     */
+    virtual void clear() = 0;
+};
+
+/*!
+ * \brief Extracts the structural paths of PDF documents by a breadth-first
+ * traversal, for a single document or a batch, and passes them to a sink.
+ *
+ * It implements the command line shared by pdf2paths and pdf2vals.
+ */
+class PathExtractor {
+private:
+    /*
+     * A node of the traversal. When pruning, it holds the state of its
+     * path in the feature trie. Entries whose paths cannot lead to a
+     * feature are not queued, so their objects are neither fetched nor
+     * traversed.
+     */
+    struct bfsnode {
+        Object *obj;
+        pdfpath path;
+        FeatureTrie::state state;
+    };
+
+    // The program name for messages
+    const std::string prog_name;
+    // The sink of the paths and whether it takes their values
+    PathSink *sink;
+    bool want_values;
+    // True if path compaction is to be done
+    bool do_compact;
+    // True if repeated subtrees are to be skipped
+    bool do_dedup;
+    // The selected features, if the traversal is pruned
+    FeatureTrie *features;
+    // Paths and shapes of the dictionaries expanded in the document
+    std::unordered_set<std::string> expanded;
+    XRef *xref;
+    // Metrics of the document being processed
+    DocMetrics metrics;
+    // Where to write the metrics, if anywhere
+    std::string metrics_file;
+    // Values of the primitive elements of an array
+    std::vector<double> values;
+
+    void exit_error(const char *e);
+    std::string pathString(const pdfpath &path);
+    void printPath(const pdfpath &path, unsigned int n, const double *vals);
+    void printPath(const pdfpath &path, Object &o);
+    void push_child(std::queue<bfsnode> &unvisited, Object *op,
+                    bfsnode &parent, const std::string &key);
+    void push_entries(std::queue<bfsnode> &unvisited, bfsnode &node, Dict *d,
+                      char kind);
+    void bfs();
+    std::string extract(PDFDoc *pdfdoc,
+                        const DocMetrics::clock::time_point &start);
+    void write_metrics();
+    void run_batch(const std::string &list);
+public:
+    /*!
+     * \brief Creates an extractor for the program with the given name.
+     */
+    explicit PathExtractor(const char *prog_name);
+    ~PathExtractor();
+
+    PathExtractor(const PathExtractor &) = delete;
+    PathExtractor &operator=(const PathExtractor &) = delete;
+
+    /*!
+     * \brief Parses the command line, exiting on errors and --help.
+     *
+     * @param what what the program extracts, for the help message.
+     * @param extra the options specific to the program.
+     */
+    boost::program_options::variables_map parse_arguments(
+            int argc, char *argv[], const std::string &what,
+            const boost::program_options::options_description &extra);
+
+    /*!
+     * \brief Processes the document or batch given on the command line,
+     * passing the paths to sink, and writes the output to the standard
+     * output.
+     *
+     * @return the exit status of the program.
+     */
+    int run(const boost::program_options::variables_map &vm, PathSink &sink);
+};
+
+#endif /* PATHEXTRACTOR_H_ */
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * PathIndex.cpp
+ */
+
+#include "PathIndex.h"
+
+#include <cstdio> // remove(), rename()
+#include <cstdlib> // strtod()
+#include <cstring>
+#include <memory>
+
+#define PATHINDEX_HEADER "HIDOST INDEX 1"
+
+static void put_varint(std::string &out, unsigned long v) {
+    while (v >= 0x80UL) {
+        out.push_back(static_cast<char>((v & 0x7FUL) | 0x80UL));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+/*
+ * Reads a varint from a stream. Returns false at the end of the stream.
+ */
+static bool get_varint(std::istream &in, unsigned long &v) {
+    v = 0UL;
+    for (unsigned int shift = 0U; shift < 64U; shift += 7U) {
+        const int c = in.get();
+        if (c == EOF) {
+            return false;
+        }
+        v |= static_cast<unsigned long>(c & 0x7F) << shift;
+        if ((c & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Reads a varint from a string at pos and returns the position after it.
+ */
+static std::size_t get_varint(const std::string &in, std::size_t pos,
+                              unsigned long &v) {
+    v = 0UL;
+    for (unsigned int shift = 0U; shift < 64U and pos < in.size();
+            shift += 7U) {
+        const unsigned char c = in[pos++];
+        v |= static_cast<unsigned long>(c & 0x7F) << shift;
+        if ((c & 0x80) == 0) {
+            return pos;
+        }
+    }
+    throw "Malformed posting list in the path index.";
+}
+
+static void write_entry(std::ostream &out, const std::string &path,
+                        unsigned int ndocs, unsigned int last,
+                        const std::string &bytes) {
+    std::string head;
+    put_varint(head, path.size());
+    head += path;
+    put_varint(head, ndocs);
+    put_varint(head, last);
+    put_varint(head, bytes.size());
+    out << head << bytes;
+}
+
+/*
+ * Reads the fields of an entry up to its posting list. Returns false at
+ * the end of the index.
+ */
+static bool read_entry(std::istream &in, std::string &path,
+                       unsigned int &ndocs, unsigned int &last,
+                       std::size_t &nbytes) {
+    unsigned long len, n, l, b;
+    if (not get_varint(in, len)) {
+        return false;
+    }
+    path.resize(len);
+    in.read(&path[0], len);
+    if (not in or not get_varint(in, n) or not get_varint(in, l)
+            or not get_varint(in, b)) {
+        throw "Truncated entry in the path index.";
+    }
+    ndocs = n;
+    last = l;
+    nbytes = b;
+    return true;
+}
+
+PathIndexWriter::PathIndexWriter(const std::string &fname, bool values,
+                                 std::size_t memory) :
+        fname(fname), values(values), memory(memory), documents(), table(),
+        used(0U), runs() {
+}
+
+PathIndexWriter::~PathIndexWriter() {
+    for (const auto &run : runs) {
+        std::remove(run.c_str());
+    }
+}
+
+void PathIndexWriter::add(const std::string &name, const std::string &data) {
+    const unsigned int id = documents.size();
+    documents.push_back(name);
+    const std::string end_of_path("\0\0", 2U);
+    std::string path;
+    std::size_t pos = 0U;
+    while (pos < data.size()) {
+        std::size_t end = data.find(end_of_path, pos);
+        if (end == std::string::npos) {
+            throw "Malformed path file.";
+        }
+        end += end_of_path.size();
+        path.assign(data, pos, end - pos);
+        // The first value follows the space after the path
+        const double val = values and end < data.size() ?
+                std::strtod(data.c_str() + end + 1U, nullptr) : 1.0;
+        pos = data.find('\n', end);
+        pos = pos == std::string::npos ? data.size() : pos + 1U;
+
+        Postings &p = table.get(path, Postings{0U, 0U, std::string()});
+        if (p.ndocs > 0U and p.last == id) {
+            // A repeated path keeps its first value, like match_features()
+            continue;
+        }
+        const std::size_t capacity = p.bytes.capacity();
+        if (p.ndocs == 0U) {
+            used += path.size() + sizeof(Postings) + 4U * sizeof(void *);
+            put_varint(p.bytes, id);
+        } else {
+            put_varint(p.bytes, id - p.last);
+        }
+        if (values) {
+            p.bytes.append(reinterpret_cast<const char *>(&val), sizeof(val));
+        }
+        p.ndocs++;
+        p.last = id;
+        used += p.bytes.capacity() - capacity;
+    }
+    if (used > memory) {
+        write_run();
+    }
+}
+
+void PathIndexWriter::write_run() {
+    const std::string name(fname + ".run" + std::to_string(runs.size()));
+    std::ofstream out(name, std::ios::binary | std::ios::trunc);
+    runs.push_back(name);
+    table.for_each_sorted([&out](const std::string &path, Postings &p) {
+        write_entry(out, path, p.ndocs, p.last, p.bytes);
+    });
+    out.close();
+    if (not out) {
+        throw "Unable to write a run of the path index.";
+    }
+    table.clear();
+    used = 0U;
+}
+
+/*
+ * Merges the sorted runs into the index. Runs hold increasing document
+ * IDs, so the posting lists of a path are concatenated in run order. The
+ * first ID of every run but the first is stored as is and has to be
+ * turned into a difference.
+ */
+void PathIndexWriter::merge_runs(std::ofstream &out) {
+    struct Run {
+        std::ifstream in;
+        std::string path;
+        unsigned int ndocs;
+        unsigned int last;
+        std::size_t nbytes;
+        bool valid;
+    };
+    std::vector<std::unique_ptr<Run> > rs;
+    for (const auto &name : runs) {
+        rs.push_back(std::unique_ptr<Run>(new Run()));
+        Run &r = *rs.back();
+        r.in.open(name, std::ios::binary);
+        r.valid = read_entry(r.in, r.path, r.ndocs, r.last, r.nbytes);
+    }
+    std::string path, bytes, merged;
+    while (true) {
+        // The smallest path of all runs
+        const std::string *min = nullptr;
+        for (const auto &r : rs) {
+            if (r->valid and (min == nullptr or r->path < *min)) {
+                min = &r->path;
+            }
+        }
+        if (min == nullptr) {
+            break;
+        }
+        path = *min;
+        unsigned int ndocs = 0U, last = 0U;
+        merged.clear();
+        for (const auto &r : rs) {
+            if (not r->valid or r->path != path) {
+                continue;
+            }
+            bytes.resize(r->nbytes);
+            r->in.read(&bytes[0], r->nbytes);
+            if (not r->in) {
+                throw "Unable to read a run of the path index.";
+            }
+            if (ndocs == 0U) {
+                merged = bytes;
+            } else {
+                unsigned long first;
+                const std::size_t pos = get_varint(bytes, 0U, first);
+                put_varint(merged, first - last);
+                merged.append(bytes, pos, std::string::npos);
+            }
+            ndocs += r->ndocs;
+            last = r->last;
+            r->valid = read_entry(r->in, r->path, r->ndocs, r->last,
+                                  r->nbytes);
+        }
+        write_entry(out, path, ndocs, last, merged);
+    }
+}
+
+void PathIndexWriter::finish() {
+    if (table.size() > 0U or runs.empty()) {
+        write_run();
+    }
+    const std::string tmpname(fname + ".tmp");
+    std::ofstream out(tmpname, std::ios::binary | std::ios::trunc);
+    out << PATHINDEX_HEADER << '\n' << documents.size() << ' ' << values
+        << '\n';
+    for (const auto &name : documents) {
+        out << name << '\n';
+    }
+    merge_runs(out);
+    out.close();
+    if (not out or std::rename(tmpname.c_str(), fname.c_str()) != 0) {
+        throw "Unable to write the path index.";
+    }
+    for (const auto &run : runs) {
+        std::remove(run.c_str());
+    }
+    runs.clear();
+}
+
+PathIndex::PathIndex(const char *fname) :
+        in(fname, std::ios::binary), values(false), documents(), current(),
+        ndocs(0U), pending(0U) {
+    std::string header;
+    if (not std::getline(in, header) or header != PATHINDEX_HEADER) {
+        throw "Not a path index file.";
+    }
+    std::size_t n;
+    int v;
+    if (not (in >> n >> v) or in.get() != '\n') {
+        throw "Malformed header of the path index.";
+    }
+    values = v != 0;
+    documents.resize(n);
+    for (auto &name : documents) {
+        if (not std::getline(in, name)) {
+            throw "Truncated document list in the path index.";
+        }
+    }
+}
+
+bool PathIndex::next() {
+    if (pending > 0U) {
+        in.seekg(pending, std::ios::cur);
+        pending = 0U;
+    }
+    unsigned int last;
+    return read_entry(in, current, ndocs, last, pending);
+}
+
+void PathIndex::postings(std::vector<std::pair<unsigned int, double> > &p) {
+    p.clear();
+    std::string bytes(pending, '\0');
+    in.read(&bytes[0], pending);
+    if (not in) {
+        throw "Truncated posting list in the path index.";
+    }
+    pending = 0U;
+    std::size_t pos = 0U;
+    unsigned long id = 0UL;
+    while (pos < bytes.size()) {
+        unsigned long gap;
+        pos = get_varint(bytes, pos, gap);
+        id = p.empty() ? gap : id + gap;
+        double val = 1.0;
+        if (values) {
+            if (pos + sizeof(val) > bytes.size()) {
+                throw "Malformed posting list in the path index.";
+            }
+            std::memcpy(&val, bytes.data() + pos, sizeof(val));
+            pos += sizeof(val);
+        }
+        p.push_back({static_cast<unsigned int>(id), val});
+    }
+}
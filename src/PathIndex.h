@@ -0,0 +1,171 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * PathIndex.h
+ */
+
+#ifndef PATHINDEX_H_
+#define PATHINDEX_H_
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "PathTable.h"
+
+/*
+ * An inverted index of path files, which maps every path to the list of
+ * documents (path files) it occurs in, its posting list.
+ *
+ * An index file starts with the line "HIDOST INDEX 1", a line holding the
+ * number of documents and 1 if the index holds values or 0 otherwise,
+ * and the names of the documents, one per line. Document IDs are line
+ * numbers in this list, starting from 0. The paths follow, sorted, each
+ * as an entry of these fields:
+ *
+ *   varint  length of the path string
+ *   bytes   the path string, as in a path file
+ *   varint  number of documents in the posting list
+ *   varint  the last document ID in the posting list
+ *   varint  length of the posting list in bytes
+ *   bytes   the posting list
+ *
+ * A posting list holds the increasing document IDs, the first one as is
+ * and all others as the difference to the previous one. With values,
+ * every ID is followed by the value of the path in the document, as a
+ * double in native byte order. Varints are unsigned LEB128, i.e., 7 bits
+ * per byte, least significant first, with the high bit set in all bytes
+ * but the last.
+ */
+
+/*!
+ * \brief Builds an inverted index from path files.
+ *
+ * Documents are added in the order of their IDs. Their posting lists are
+ * collected in memory until they exceed the memory limit, then written
+ * out as a sorted run next to the index file. finish() merges all runs
+ * into the index, so an index of any size can be built with bounded
+ * memory.
+ */
+class PathIndexWriter {
+private:
+    // The posting list of a path
+    struct Postings {
+        unsigned int ndocs;
+        unsigned int last;
+        std::string bytes;
+    };
+
+    const std::string fname;
+    const bool values;
+    const std::size_t memory;
+    std::vector<std::string> documents;
+    PathTable<Postings> table;
+    // Estimated memory use of the table
+    std::size_t used;
+    std::vector<std::string> runs;
+
+    void write_run();
+    void merge_runs(std::ofstream &out);
+public:
+    /*!
+     * \brief Starts an index.
+     *
+     * @param fname the name of the index file.
+     * @param values whether to store the values of the paths.
+     * @param memory the memory limit of the posting lists in bytes.
+     */
+    PathIndexWriter(const std::string &fname, bool values,
+                    std::size_t memory);
+
+    /*!
+     * \brief Removes the runs left by an unfinished index.
+     */
+    ~PathIndexWriter();
+
+    PathIndexWriter(const PathIndexWriter &) = delete;
+    PathIndexWriter &operator=(const PathIndexWriter &) = delete;
+
+    /*!
+     * \brief Adds a document.
+     *
+     * @param name the name of the document.
+     * @param data the contents of its path file, lines of a path string, a
+     * space, a value and optionally further values, sorted by path.
+     */
+    void add(const std::string &name, const std::string &data);
+
+    /*!
+     * \brief Writes the index file.
+     */
+    void finish();
+};
+
+/*!
+ * \brief Reads an inverted index entry by entry, in path order.
+ */
+class PathIndex {
+private:
+    std::ifstream in;
+    bool values;
+    std::vector<std::string> documents;
+    std::string current;
+    unsigned int ndocs;
+    // Unread bytes of the posting list of the current path
+    std::size_t pending;
+public:
+    /*!
+     * \brief Opens an index file and reads its document names.
+     */
+    explicit PathIndex(const char *fname);
+
+    const std::vector<std::string> &getDocuments() const {
+        return documents;
+    }
+    bool hasValues() const {
+        return values;
+    }
+
+    /*!
+     * \brief Advances to the next path, skipping the posting list of the
+     * current one if it has not been read.
+     *
+     * @return false at the end of the index.
+     */
+    bool next();
+
+    const std::string &path() const {
+        return current;
+    }
+    /*!
+     * \brief Returns the number of documents the current path occurs in.
+     */
+    unsigned int count() const {
+        return ndocs;
+    }
+
+    /*!
+     * \brief Reads the posting list of the current path as pairs of
+     * document IDs and values. Without values, all values are 1.
+     */
+    void postings(std::vector<std::pair<unsigned int, double> > &p);
+};
+
+#endif /* PATHINDEX_H_ */
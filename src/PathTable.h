@@ -0,0 +1,170 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * PathTable.h
+ */
+
+#ifndef PATHTABLE_H_
+#define PATHTABLE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pdfpath.h"
+
+/*!
+ * \brief A hash table from path strings to values of type V.
+ *
+ * Paths are copied into an arena of large blocks and looked up through
+ * an open-addressing table with linear probing. Entries are only sorted
+ * once, when they are visited in path order, which is the order of a
+ * std::map<std::string, V>.
+ */
+template<typename V>
+class PathTable {
+private:
+    struct Entry {
+        std::size_t hash;
+        const char *str;
+        std::size_t len;
+        V value;
+    };
+    // Size of a regular arena block
+    static const std::size_t BLOCK_SIZE = 64U * 1024U;
+
+    // Entries in insertion order
+    std::vector<Entry> entries;
+    // Indices of entries plus one, 0 for empty slots; the size is a
+    // power of two
+    std::vector<std::size_t> slots;
+    // Arena blocks holding the path strings
+    std::vector<std::unique_ptr<char[]> > blocks;
+    char *free_ptr;
+    std::size_t free_len;
+
+    const char *store(const char *str, std::size_t len) {
+        if (len > free_len) {
+            const std::size_t size = std::max(len, BLOCK_SIZE);
+            blocks.push_back(std::unique_ptr<char[]>(new char[size]));
+            free_ptr = blocks.back().get();
+            free_len = size;
+        }
+        char *s = free_ptr;
+        std::memcpy(s, str, len);
+        free_ptr += len;
+        free_len -= len;
+        return s;
+    }
+
+    void grow() {
+        std::vector<std::size_t> new_slots(slots.size() * 2U, 0U);
+        const std::size_t mask = new_slots.size() - 1U;
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            std::size_t s = entries[i].hash & mask;
+            while (new_slots[s] != 0U) {
+                s = (s + 1U) & mask;
+            }
+            new_slots[s] = i + 1U;
+        }
+        slots.swap(new_slots);
+    }
+
+    static bool less(const Entry &a, const Entry &b) {
+        const int c = std::memcmp(a.str, b.str, std::min(a.len, b.len));
+        return c < 0 or (c == 0 and a.len < b.len);
+    }
+public:
+    PathTable() :
+            entries(), slots(1024U, 0U), blocks(), free_ptr(nullptr),
+            free_len(0U) {
+    }
+
+    /*!
+     * \brief Returns the value of a path, inserting init if the path is
+     * not in the table yet.
+     */
+    V &get(const std::string &path, const V &init = V()) {
+        const std::size_t hash = pdfpath_hash(path.data(), path.size());
+        const std::size_t mask = slots.size() - 1U;
+        std::size_t s = hash & mask;
+        while (slots[s] != 0U) {
+            Entry &e = entries[slots[s] - 1U];
+            if (e.hash == hash and e.len == path.size() and
+                    std::memcmp(e.str, path.data(), e.len) == 0) {
+                return e.value;
+            }
+            s = (s + 1U) & mask;
+        }
+        entries.push_back({hash, store(path.data(), path.size()),
+                           path.size(), init});
+        slots[s] = entries.size();
+        // Keep the load factor at or below one half
+        if (entries.size() * 2U > slots.size()) {
+            grow();
+        }
+        return entries.back().value;
+    }
+
+    std::size_t size() const {
+        return entries.size();
+    }
+
+    /*!
+     * \brief Removes all entries and frees the arena.
+     */
+    void clear() {
+        entries.clear();
+        slots.assign(1024U, 0U);
+        blocks.clear();
+        free_ptr = nullptr;
+        free_len = 0U;
+    }
+
+    /*!
+     * \brief Calls f(path, value) for all entries, sorted by path.
+     *
+     * Paths are passed as std::string. Sorting compares bytes as unsigned
+     * characters, then lengths, like std::string comparison does.
+     */
+    template<typename F>
+    void for_each_sorted(F f) {
+        std::vector<Entry *> sorted;
+        sorted.reserve(entries.size());
+        for (auto &e : entries) {
+            sorted.push_back(&e);
+        }
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const Entry *a, const Entry *b) {
+            return less(*a, *b);
+        });
+        std::string path;
+        for (Entry *e : sorted) {
+            path.assign(e->str, e->len);
+            f(path, e->value);
+        }
+    }
+};
+
+template<typename V>
+const std::size_t PathTable<V>::BLOCK_SIZE;
+
+#endif /* PATHTABLE_H_ */
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * RefSet.cpp
+ */
+
+#include "RefSet.h"
+
+RefSet::RefSet(int num_objects) :
+        visited(num_objects > 0 ? num_objects : 0, false), others() {
+}
+
+bool RefSet::insert(const Ref &r) {
+    if (r.gen == 0 and r.num >= 0 and
+            static_cast<std::vector<bool>::size_type>(r.num) < visited.size()) {
+        if (visited[r.num]) {
+            return false;
+        }
+        visited[r.num] = true;
+        return true;
+    }
+    return others.insert(std::make_pair(r.num, r.gen)).second;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * RefSet.h
+ */
+
+#ifndef REFSET_H_
+#define REFSET_H_
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <poppler/Object.h>
+
+/*!
+ * \brief A set of visited PDF object references.
+ *
+ * References to generation 0 objects within the range of the XRef table,
+ * i.e., nearly all of them, are tracked in a bitmap indexed by object
+ * number. All other references go to an ordered set.
+ */
+class RefSet {
+private:
+    std::vector<bool> visited;
+    std::set<std::pair<int, int> > others;
+public:
+    /*!
+     * \brief Creates an empty set for a document with the given number of
+     * XRef table entries.
+     */
+    explicit RefSet(int num_objects);
+
+    /*!
+     * \brief Adds a reference to the set.
+     *
+     * @return true if the reference was not in the set before.
+     */
+    bool insert(const Ref &r);
+};
+
+#endif /* REFSET_H_ */
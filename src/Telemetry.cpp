@@ -0,0 +1,245 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Telemetry.cpp
+ */
+
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <cstdio> // rename()
+#include <cstdlib> // strtoull()
+#include <exception> // uncaught_exception()
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <dirent.h> // opendir()
+#include <sys/resource.h> // getrusage()
+#include <unistd.h> // getpid(), sysconf()
+
+/*
+ * Reads the ages in seconds of the live child processes of this process.
+ * Returns false if they cannot be read.
+ */
+static bool child_ages(std::vector<double> &ages) {
+    DIR *tasks = opendir("/proc/self/task");
+    if (tasks == nullptr) {
+        return false;
+    }
+    std::vector<std::string> pids;
+    // Threads may exit while they are listed, so one readable list of
+    // children suffices
+    bool readable = false;
+    while (const dirent *task = readdir(tasks)) {
+        if (task->d_name[0] == '.') {
+            continue;
+        }
+        std::ifstream in(std::string("/proc/self/task/") + task->d_name
+                         + "/children");
+        readable = readable or in.is_open();
+        std::string pid;
+        while (in >> pid) {
+            pids.push_back(pid);
+        }
+    }
+    closedir(tasks);
+    double uptime;
+    if (not readable or not (std::ifstream("/proc/uptime") >> uptime)) {
+        return false;
+    }
+
+    const double ticks = sysconf(_SC_CLK_TCK);
+    for (const auto &pid : pids) {
+        std::ifstream in("/proc/" + pid + "/stat");
+        std::string line;
+        std::getline(in, line);
+        // The command name may contain anything but ends with the last ')'
+        const std::size_t pos = line.rfind(')');
+        if (pos == std::string::npos) {
+            continue;
+        }
+        // The start time is the 20th field after the command name
+        std::istringstream fields(line.substr(pos + 1U));
+        std::string field;
+        for (unsigned int i = 0U; i < 20U; i++) {
+            fields >> field;
+        }
+        if (fields) {
+            const double started = std::strtoull(field.c_str(), nullptr, 10)
+                                   / ticks;
+            ages.push_back(std::max(uptime - started, 0.0));
+        }
+    }
+    return true;
+}
+
+Telemetry::Telemetry(const std::string &fname, const std::string &program,
+                     unsigned int interval_ms) :
+        fname(fname), program(program), interval_ms(interval_ms),
+        start(clock::now()), mutex(), stop_cond(), stopping(false), writer(),
+        pools(0UL), completed(0UL), failed(0UL), bytes_in(0ULL),
+        bytes_out(0ULL), in_pool(false), pool_children(false),
+        pool_workers(0U), pool_jobs(0UL), pool_completed(0UL), pool_start() {
+    writer = boost::thread(&Telemetry::write_loop, this);
+}
+
+Telemetry::~Telemetry() {
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        stopping = true;
+    }
+    stop_cond.notify_all();
+    writer.join();
+    write_status(std::uncaught_exception() ? "aborted" : "done");
+}
+
+void Telemetry::write_loop() {
+    boost::mutex::scoped_lock lock(mutex);
+    while (not stopping) {
+        lock.unlock();
+        write_status("running");
+        lock.lock();
+        stop_cond.timed_wait(lock, boost::posix_time::milliseconds(interval_ms),
+                             [this]() {
+                                 return stopping;
+                             });
+    }
+}
+
+void Telemetry::start_pool(std::size_t jobs, unsigned int workers,
+                           bool children) {
+    if (workers == 0U) {
+        workers = std::max(boost::thread::hardware_concurrency(), 2U) - 1U;
+    }
+    boost::mutex::scoped_lock lock(mutex);
+    pools++;
+    in_pool = true;
+    pool_children = children;
+    pool_workers = workers;
+    pool_jobs = jobs;
+    pool_completed = 0UL;
+    pool_start = clock::now();
+}
+
+void Telemetry::job_done(std::size_t in, std::size_t out) {
+    boost::mutex::scoped_lock lock(mutex);
+    completed++;
+    pool_completed++;
+    bytes_in += in;
+    bytes_out += out;
+}
+
+void Telemetry::finish_pool() {
+    boost::mutex::scoped_lock lock(mutex);
+    if (pool_jobs > pool_completed) {
+        failed += pool_jobs - pool_completed;
+    }
+    in_pool = false;
+}
+
+/*
+ * Writes the status to a temporary file and renames it over the status
+ * file. The status is advisory, so failures are ignored and the next
+ * update tries again.
+ */
+void Telemetry::write_status(const char *state) {
+    const clock::time_point now = clock::now();
+    std::ostringstream ss;
+    bool pool;
+    bool children;
+    unsigned int workers;
+    unsigned long jobs, done;
+    double pool_elapsed;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        ss << "{\"program\":\"" << program << "\",\"pid\":" << getpid()
+           << ",\"state\":\"" << state << "\",\"elapsed_s\":"
+           << std::chrono::duration<double>(now - start).count()
+           << ",\"pools\":" << pools
+           << ",\"jobs_completed\":" << completed
+           << ",\"jobs_failed\":" << failed
+           << ",\"bytes_in\":" << bytes_in
+           << ",\"bytes_out\":" << bytes_out;
+        pool = in_pool;
+        children = pool_children;
+        workers = pool_workers;
+        jobs = pool_jobs;
+        done = pool_completed;
+        pool_elapsed = std::chrono::duration<double>(now - pool_start).count();
+    }
+
+    struct rusage ru;
+    if (getrusage(RUSAGE_CHILDREN, &ru) == 0) {
+        ss << ",\"children_user_s\":"
+           << ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6
+           << ",\"children_sys_s\":"
+           << ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6
+           // Linux reports ru_maxrss in kilobytes
+           << ",\"children_maxrss_mb\":" << ru.ru_maxrss / 1024.0;
+    }
+
+    ss << ",\"pool\":";
+    if (not pool) {
+        ss << "null}\n";
+    } else {
+        std::vector<double> ages;
+        const bool known = children and child_ages(ages);
+        const unsigned long busy = ages.size();
+        const unsigned long left = jobs > done ? jobs - done : 0UL;
+        ss << "{\"jobs\":" << jobs << ",\"completed\":" << done
+           << ",\"queued\":" << (left > busy ? left - busy : 0UL)
+           << ",\"workers\":" << workers;
+        if (known) {
+            ss << ",\"busy\":" << busy << ",\"idle\":"
+               << (workers > busy ? workers - busy : 0UL);
+        } else {
+            ss << ",\"busy\":null,\"idle\":null";
+        }
+        const double rate = pool_elapsed > 0.0 ? done / pool_elapsed : 0.0;
+        ss << ",\"rate_per_s\":" << rate << ",\"eta_s\":";
+        if (rate > 0.0) {
+            ss << left / rate;
+        } else {
+            ss << "null";
+        }
+        if (known) {
+            // Ages of the running child processes, to spot stalls
+            const double bounds[] = {1.0, 10.0, 60.0, 600.0};
+            unsigned int hist[5] = {0U, 0U, 0U, 0U, 0U};
+            for (const double age : ages) {
+                hist[std::upper_bound(bounds, bounds + 4, age) - bounds]++;
+            }
+            ss << ",\"oldest_child_s\":"
+               << (ages.empty() ? 0.0 :
+                       *std::max_element(ages.begin(), ages.end()))
+               << ",\"child_ages\":{\"lt1s\":" << hist[0] << ",\"lt10s\":"
+               << hist[1] << ",\"lt1m\":" << hist[2] << ",\"lt10m\":"
+               << hist[3] << ",\"ge10m\":" << hist[4] << '}';
+        }
+        ss << "}}\n";
+    }
+
+    const std::string tmpname(fname + ".tmp");
+    std::ofstream out(tmpname, std::ios::binary | std::ios::trunc);
+    out << ss.str();
+    out.close();
+    if (out) {
+        std::rename(tmpname.c_str(), fname.c_str());
+    }
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Telemetry.h
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include <boost/thread.hpp>
+
+/*!
+ * \brief Publishes live counters of the worker pools of a program in a
+ * status file, which is rewritten every interval and replaced atomically,
+ * so that it can be polled at any time.
+ *
+ * quickly::ThreadPool offers no hooks into its scheduling, so the
+ * counters are gathered around it:
+ *
+ * - Completed jobs and their bytes are counted by the data actions,
+ *   whose doFull() is only called for child processes that succeeded.
+ * - Jobs of a pool that never completed, including those of child
+ *   processes killed for exceeding --vm-limit or --cpu-time, are counted
+ *   as failed when the pool finishes.
+ * - Busy workers are the live child processes of this process, read from
+ *   /proc/self/task/<tid>/children. Their ages are taken from
+ *   /proc/<pid>/stat. Without these files, they are reported as null.
+ * - The CPU time and peak memory of finished child processes are those
+ *   reported by getrusage(RUSAGE_CHILDREN).
+ *
+ * The status is a single JSON object:
+ *
+ *   {"program":"cacher","pid":4711,"state":"running","elapsed_s":62.1,
+ *    "pools":3,"jobs_completed":2810,"jobs_failed":2,
+ *    "bytes_in":91822612,"bytes_out":20413870,
+ *    "children_user_s":401.2,"children_sys_s":20.7,"children_maxrss_mb":310.4,
+ *    "pool":{"jobs":1000,"completed":640,"queued":352,"workers":8,
+ *            "busy":8,"idle":0,"rate_per_s":22.5,"eta_s":16.0,
+ *            "oldest_child_s":41.9,
+ *            "child_ages":{"lt1s":5,"lt10s":2,"lt1m":1,"lt10m":0,"ge10m":0}}}
+ *
+ * "state" is "running", "done" or "aborted". "pool" is null between
+ * pools. Queued jobs are those neither completed nor running, so failed
+ * jobs count as queued until their pool finishes. The rate and the ETA
+ * are those of the current pool, as later pools may not be known yet.
+ * Fork and exec latency and the runtime of finished child processes are
+ * not observable outside of the pool and not reported.
+ */
+class Telemetry {
+private:
+    typedef std::chrono::steady_clock clock;
+
+    const std::string fname;
+    const std::string program;
+    const unsigned int interval_ms;
+    const clock::time_point start;
+
+    boost::mutex mutex;
+    boost::condition_variable stop_cond;
+    bool stopping;
+    boost::thread writer;
+
+    // Totals of all pools
+    unsigned long pools;
+    unsigned long completed;
+    unsigned long failed;
+    unsigned long long bytes_in;
+    unsigned long long bytes_out;
+
+    // The current pool
+    bool in_pool;
+    bool pool_children;
+    unsigned int pool_workers;
+    unsigned long pool_jobs;
+    unsigned long pool_completed;
+    clock::time_point pool_start;
+
+    void write_loop();
+    void write_status(const char *state);
+public:
+    /*!
+     * \brief Starts writing the status file every interval_ms
+     * milliseconds.
+     *
+     * @param fname the name of the status file.
+     * @param program the name of the program.
+     * @param interval_ms the interval between updates in milliseconds.
+     */
+    Telemetry(const std::string &fname, const std::string &program,
+              unsigned int interval_ms = 1000U);
+
+    /*!
+     * \brief Stops the updates and writes the final status, "done", or
+     * "aborted" if an exception is propagating.
+     */
+    ~Telemetry();
+
+    Telemetry(const Telemetry &) = delete;
+    Telemetry &operator=(const Telemetry &) = delete;
+
+    /*!
+     * \brief Marks the start of a pool.
+     *
+     * @param jobs the number of jobs of the pool.
+     * @param workers the number of jobs run in parallel, 0 for the
+     * default of quickly::ThreadPool, the number of cores minus one.
+     * @param children whether the jobs run in child processes.
+     */
+    void start_pool(std::size_t jobs, unsigned int workers,
+                    bool children = true);
+
+    /*!
+     * \brief Counts a completed job.
+     *
+     * @param in the number of bytes read from the job.
+     * @param out the number of bytes written for the job.
+     */
+    void job_done(std::size_t in, std::size_t out);
+
+    /*!
+     * \brief Marks the end of the current pool and counts its jobs that
+     * did not complete as failed.
+     */
+    void finish_pool();
+
+    /*!
+     * \brief Marks a pool for the lifetime of the object, given a
+     * Telemetry object, or does nothing, given nullptr.
+     */
+    class PoolScope {
+    private:
+        Telemetry *telemetry;
+    public:
+        PoolScope(Telemetry *telemetry, std::size_t jobs,
+                  unsigned int workers, bool children = true) :
+                telemetry(telemetry) {
+            if (telemetry != nullptr) {
+                telemetry->start_pool(jobs, workers, children);
+            }
+        }
+        ~PoolScope() {
+            if (telemetry != nullptr) {
+                telemetry->finish_pool();
+            }
+        }
+        PoolScope(const PoolScope &) = delete;
+        PoolScope &operator=(const PoolScope &) = delete;
+    };
+};
+
+#endif /* TELEMETRY_H_ */
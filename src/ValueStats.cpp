@@ -0,0 +1,134 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ValueStats.cpp
+ */
+
+#include "ValueStats.h"
+
+#include <algorithm>
+#include <cmath> // round()
+
+// Quantiles of the P-square markers for the median
+static const double QUANTILES[5] = { 0.0, 0.25, 0.5, 0.75, 1.0 };
+
+ValueStats::ValueStats(unsigned int exact_limit) :
+        exact_limit(std::max(exact_limit, 5U)), values(), heights(),
+        positions(), desired(), n(0UL), vmin(0.0), vmax(0.0), sum(0.0) {
+}
+
+void ValueStats::add(double v) {
+    if (n == 0UL or v < vmin) {
+        vmin = v;
+    }
+    if (n == 0UL or v > vmax) {
+        vmax = v;
+    }
+    sum += v;
+    n++;
+    if (n <= exact_limit) {
+        values.push_back(v);
+    } else {
+        if (n == exact_limit + 1UL) {
+            start_estimate();
+        }
+        estimate(v);
+    }
+}
+
+double ValueStats::median() {
+    if (not exact()) {
+        return heights[2];
+    }
+    if (values.empty()) {
+        return 0.0;
+    }
+    const std::vector<double>::size_type median_i = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + median_i, values.end());
+    return values[median_i];
+}
+
+/*
+ * Places the markers on the sorted values kept so far, instead of on the
+ * first five values only, and drops the values.
+ */
+void ValueStats::start_estimate() {
+    std::sort(values.begin(), values.end());
+    const double last = values.size() - 1;
+    for (int i = 0; i < 5; i++) {
+        const unsigned int pos = std::round(QUANTILES[i] * last);
+        heights[i] = values[pos];
+        positions[i] = pos + 1.0;
+        desired[i] = QUANTILES[i] * last + 1.0;
+    }
+    std::vector<double>().swap(values);
+}
+
+double ValueStats::parabolic(int i, double d) const {
+    return heights[i] + d / (positions[i + 1] - positions[i - 1]) *
+            ((positions[i] - positions[i - 1] + d) *
+             (heights[i + 1] - heights[i]) /
+             (positions[i + 1] - positions[i]) +
+             (positions[i + 1] - positions[i] - d) *
+             (heights[i] - heights[i - 1]) /
+             (positions[i] - positions[i - 1]));
+}
+
+double ValueStats::linear(int i, int d) const {
+    return heights[i] + d * (heights[i + d] - heights[i]) /
+            (positions[i + d] - positions[i]);
+}
+
+void ValueStats::estimate(double v) {
+    // Find the cell of the value, extending the extreme markers
+    int k;
+    if (v < heights[0]) {
+        heights[0] = v;
+        k = 0;
+    } else if (v >= heights[4]) {
+        heights[4] = v;
+        k = 3;
+    } else {
+        k = 0;
+        while (v >= heights[k + 1]) {
+            k++;
+        }
+    }
+    for (int i = k + 1; i < 5; i++) {
+        positions[i] += 1.0;
+    }
+    for (int i = 0; i < 5; i++) {
+        desired[i] += QUANTILES[i];
+    }
+
+    // Adjust the heights of the middle markers
+    for (int i = 1; i < 4; i++) {
+        const double d = desired[i] - positions[i];
+        if ((d >= 1.0 and positions[i + 1] - positions[i] > 1.0) or
+            (d <= -1.0 and positions[i - 1] - positions[i] < -1.0)) {
+            const int ds = d > 0.0 ? 1 : -1;
+            const double h = parabolic(i, ds);
+            if (heights[i - 1] < h and h < heights[i + 1]) {
+                heights[i] = h;
+            } else {
+                heights[i] = linear(i, ds);
+            }
+            positions[i] += ds;
+        }
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ValueStats.h
+ */
+
+#ifndef VALUESTATS_H_
+#define VALUESTATS_H_
+
+#include <vector>
+
+/*!
+ * \brief Streaming statistics of the values of a path.
+ *
+ * Values are kept until their number exceeds the exact limit, so that
+ * the median of a small number of values is exact. Beyond the limit,
+ * the median is estimated with the P-square algorithm of Jain and
+ * Chlamtac, which uses five markers and thus a fixed amount of memory.
+ * The count, minimum, maximum and mean are always exact.
+ */
+class ValueStats {
+private:
+    // Maximal number of values kept for the exact median
+    unsigned int exact_limit;
+    // The values, while their number is within the exact limit
+    std::vector<double> values;
+    // P-square marker heights, actual and desired marker positions
+    double heights[5];
+    double positions[5];
+    double desired[5];
+
+    unsigned long n;
+    double vmin;
+    double vmax;
+    double sum;
+
+    void start_estimate();
+    void estimate(double v);
+    double parabolic(int i, double d) const;
+    double linear(int i, int d) const;
+public:
+    // The default maximal number of values for an exact median
+    static const unsigned int DEFAULT_EXACT_LIMIT = 1024U;
+
+    explicit ValueStats(unsigned int exact_limit = DEFAULT_EXACT_LIMIT);
+
+    void add(double v);
+
+    /*!
+     * \brief Returns the median of the values.
+     *
+     * The exact median of an even number of values is the upper one of
+     * the two middle values.
+     */
+    double median();
+
+    bool exact() const {
+        return n <= exact_limit;
+    }
+    unsigned long count() const {
+        return n;
+    }
+    double min() const {
+        return vmin;
+    }
+    double max() const {
+        return vmax;
+    }
+    double mean() const {
+        return n == 0UL ? 0.0 : sum / n;
+    }
+};
+
+#endif /* VALUESTATS_H_ */
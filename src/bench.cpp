@@ -0,0 +1,623 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * bench.cpp
+ */
+
+/*
+ * This program runs microbenchmarks of the functions on the hot paths of
+ * the Hidost toolchain. All inputs are generated from a seeded random
+ * number generator, so that runs with the same seed and scale are
+ * comparable across builds. Results are written as JSON lines.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h> // open()
+#include <stdlib.h> // mkdtemp()
+#include <unistd.h> // close(), unlink(), rmdir()
+
+#include <boost/program_options.hpp>
+
+#include "AsyncReader.h"
+#include "Model.h"
+#include "NPPFFile.h"
+#include "PathTable.h"
+#include "ValueStats.h"
+#include "featmatch.h"
+#include "pathmerge.h"
+#include "pdfpath.h"
+
+namespace po = boost::program_options;
+
+typedef std::chrono::steady_clock benchclock;
+
+/*
+ * Names that make up generated paths. They include the names matched by
+ * the compaction regular expressions, so that all of them get exercised.
+ */
+static const char *NAMES[] = {
+    "Pages", "Kids", "Parent", "Resources", "Font", "XObject", "ExtGState",
+    "ColorSpace", "Type", "Subtype", "Contents", "Annots", "AP", "N", "D",
+    "MediaBox", "Length", "Filter", "Names", "Dests", "JavaScript",
+    "Outlines", "First", "Last", "Next", "Prev", "StructTreeRoot", "K", "P",
+    "AcroForm", "Fields", "DR", "Widths", "FontDescriptor", "CharProcs",
+    "Threads", "F", "V", "OpenAction", "S", "JS", "BaseFont", "Encoding"
+};
+static const unsigned int NNAMES = sizeof(NAMES) / sizeof(NAMES[0]);
+
+/*
+ * A reproducible generator of inputs. Only the raw output of the
+ * Mersenne Twister is used, which is the same on all platforms.
+ */
+class Generator {
+private:
+    std::mt19937 rng;
+public:
+    explicit Generator(unsigned int seed) :
+            rng(seed) {
+    }
+
+    unsigned int uniform(unsigned int n) {
+        return rng() % n;
+    }
+
+    pdfpath path() {
+        pdfpath p;
+        const unsigned int len = 1U + uniform(8U);
+        if (uniform(4U) == 0U) {
+            // A page tree path, to be compacted
+            p.push_back("Pages");
+            for (unsigned int i = uniform(6U); i > 0U; i--) {
+                p.push_back("Kids");
+            }
+        }
+        for (unsigned int i = 0U; i < len; i++) {
+            if (uniform(8U) == 0U) {
+                // A generated name, like font or image names
+                std::stringstream ss;
+                ss << 'R' << uniform(64U);
+                p.push_back(ss.str());
+            } else {
+                p.push_back(NAMES[uniform(NNAMES)]);
+            }
+        }
+        return p;
+    }
+
+    /*
+     * Returns up to n distinct path strings, sorted.
+     */
+    std::vector<std::string> sorted_paths(unsigned int n) {
+        std::set<std::string> paths;
+        for (unsigned int tries = 0U; paths.size() < n and tries < 20U * n;
+                tries++) {
+            paths.insert(pdfpath_to_string(path()));
+        }
+        return std::vector<std::string>(paths.begin(), paths.end());
+    }
+};
+
+/*
+ * Results of a single benchmark.
+ */
+struct BenchResult {
+    std::string name;
+    // Number of operations in a single run
+    unsigned long ops;
+    // Number of runs
+    unsigned int runs;
+    // Fastest and median run in milliseconds
+    double best_ms;
+    double median_ms;
+};
+
+/*
+ * Runs f the given number of times and measures it.
+ */
+template <typename F>
+BenchResult measure(const std::string &name, unsigned long ops,
+                    unsigned int runs, F f) {
+    std::vector<double> times;
+    for (unsigned int i = 0U; i < runs; i++) {
+        const benchclock::time_point start(benchclock::now());
+        f();
+        times.push_back(std::chrono::duration<double, std::milli>(
+                benchclock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return BenchResult{name, ops, runs, times.front(), times[times.size() / 2]};
+}
+
+/*
+ * Writes the paths to a file, one per line, followed by a count.
+ */
+static void write_counts(const std::string &fname,
+                         const std::vector<std::string> &paths,
+                         Generator &gen) {
+    std::ofstream out(fname, std::ios::binary | std::ios::trunc);
+    for (const auto &p : paths) {
+        out << p << ' ' << (1U + gen.uniform(1000U)) << '\n';
+    }
+}
+
+// Prevents the compiler from optimizing away benchmarked computations
+static volatile unsigned long sink;
+
+po::variables_map parse_arguments(int argc, char *argv[]) {
+    po::options_description desc(
+            "This program runs microbenchmarks of the Hidost hot functions "
+            "on generated inputs and writes the results as JSON lines. "
+            "Allowed options");
+    desc.add_options()
+            ("help", "produce help message")
+            ("output-file,o",
+                    po::value<std::string>(),
+                    "where to write the results (default: standard output)")
+            ("seed,s",
+                    po::value<unsigned int>()->default_value(42U),
+                    "seed of the input generator")
+            ("scale,x",
+                    po::value<unsigned int>()->default_value(1U),
+                    "multiplies the size of all generated inputs")
+            ("runs,r",
+                    po::value<unsigned int>()->default_value(5U),
+                    "number of runs of every benchmark")
+            ("filter,f",
+                    po::value<std::string>()->default_value(""),
+                    "only run benchmarks whose name contains this string");
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        std::exit(EXIT_SUCCESS);
+    }
+
+    try {
+        po::notify(vm);
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl << std::endl << desc << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return vm;
+}
+
+int run(int argc, char *argv[]) {
+    po::variables_map vm = parse_arguments(argc, argv);
+    const unsigned int SEED = vm["seed"].as<unsigned int>();
+    const unsigned int SCALE = std::max(vm["scale"].as<unsigned int>(), 1U);
+    const unsigned int RUNS = std::max(vm["runs"].as<unsigned int>(), 1U);
+    const std::string FILTER = vm["filter"].as<std::string>();
+
+    char tmpdir[] = "/tmp/hidost-benchXXXXXX";
+    if (mkdtemp(tmpdir) == NULL) {
+        throw "Unable to create a temporary directory.";
+    }
+    const std::string TMPDIR(tmpdir);
+    std::vector<std::string> tmpfiles;
+
+    Generator gen(SEED);
+    std::vector<BenchResult> results;
+    auto selected = [&FILTER](const std::string &name) {
+        return name.find(FILTER) != std::string::npos;
+    };
+
+    // Raw paths, as seen during PDF traversal
+    const unsigned int NPATHS = 20000U * SCALE;
+    std::vector<pdfpath> paths;
+    for (unsigned int i = 0U; i < NPATHS; i++) {
+        paths.push_back(gen.path());
+    }
+
+    if (selected("compact_pdfpath")) {
+        results.push_back(measure("compact_pdfpath", NPATHS, RUNS, [&]() {
+            for (const auto &p : paths) {
+                sink += compact_pdfpath(p).size();
+            }
+        }));
+    }
+
+    if (selected("pdfpath_to_string")) {
+        results.push_back(measure("pdfpath_to_string", NPATHS, RUNS, [&]() {
+            for (const auto &p : paths) {
+                sink += pdfpath_to_string(p).size();
+            }
+        }));
+    }
+
+    // A cache file of paths and counts
+    const std::vector<std::string> cached(gen.sorted_paths(NPATHS));
+    std::string cache_data;
+    {
+        std::stringstream ss;
+        for (const auto &p : cached) {
+            ss << p << ' ' << (1U + gen.uniform(100U)) << '\n';
+        }
+        cache_data = ss.str();
+    }
+
+    if (selected("get_pdfpath_string")) {
+        results.push_back(measure("get_pdfpath_string", cached.size(), RUNS,
+                                  [&]() {
+            std::stringstream in(cache_data);
+            while (in.good() and in.peek() != EOF) {
+                sink += get_pdfpath_string(in).size();
+                in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            }
+        }));
+    }
+
+    if (selected("parse_pdfpath")) {
+        std::string nppf_data;
+        {
+            std::stringstream ss;
+            for (const auto &p : cached) {
+                ss << p << '\n';
+            }
+            nppf_data = ss.str();
+        }
+        results.push_back(measure("parse_pdfpath", cached.size(), RUNS,
+                                  [&]() {
+            std::stringstream in(nppf_data);
+            pdfpath p;
+            while (in.good() and in.peek() != EOF) {
+                parse_pdfpath(in, p);
+                in.get();
+                sink += p.size();
+            }
+        }));
+    }
+
+    if (selected("merge_paths") or selected("merge_paths_fc")) {
+        // Every benchmark with random choices of its own has its own
+        // generator, so that its inputs do not depend on --filter
+        Generator gen(SEED + 1U);
+        // Two partially overlapping sorted count files
+        std::vector<std::string> l1, l2;
+        for (const auto &p : cached) {
+            const unsigned int r = gen.uniform(3U);
+            if (r != 1U) {
+                l1.push_back(p);
+            }
+            if (r != 0U) {
+                l2.push_back(p);
+            }
+        }
+        const std::string f1(TMPDIR + "/merge1"), f2(TMPDIR + "/merge2");
+        write_counts(f1, l1, gen);
+        write_counts(f2, l2, gen);
+        tmpfiles.push_back(f1);
+        tmpfiles.push_back(f2);
+        if (selected("merge_paths")) {
+            results.push_back(measure("merge_paths", l1.size() + l2.size(),
+                                      RUNS, [&]() {
+                std::ifstream in1(f1, std::ios::binary),
+                        in2(f2, std::ios::binary);
+                int fd = open("/dev/null", O_WRONLY);
+                merge_paths(in1, in2, fd, MERGE_SUM);
+                close(fd);
+            }));
+        }
+        if (selected("merge_paths_fc")) {
+            // The same files, front-coded like intermediate merge results
+            const std::string fc1(TMPDIR + "/merge1.fc"),
+                    fc2(TMPDIR + "/merge2.fc");
+            for (const auto &f : {std::make_pair(f1, fc1),
+                                  std::make_pair(f2, fc2)}) {
+                std::ifstream in(f.first, std::ios::binary), none;
+                int fd = open(f.second.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                              0644);
+                merge_paths(in, none, fd, MERGE_SUM, 0U, 0U, 0U, true);
+                close(fd);
+                tmpfiles.push_back(f.second);
+            }
+            results.push_back(measure("merge_paths_fc", l1.size() + l2.size(),
+                                      RUNS, [&]() {
+                std::ifstream in1(fc1, std::ios::binary),
+                        in2(fc2, std::ios::binary);
+                int fd = open("/dev/null", O_WRONLY);
+                merge_paths(in1, in2, fd, MERGE_SUM, 0U, 0U, 0U, true);
+                close(fd);
+            }));
+        }
+    }
+
+    if (selected("InNPPFFile")) {
+        const std::string fname(TMPDIR + "/features.nppf");
+        {
+            std::ofstream out(fname, std::ios::binary | std::ios::trunc);
+            out << "NPPF" << '\0' << '\0' << '\n';
+            for (const auto &p : cached) {
+                out << p << '\n';
+            }
+        }
+        tmpfiles.push_back(fname);
+        results.push_back(measure("InNPPFFile", cached.size(), RUNS, [&]() {
+            for (const auto &feat : InNPPFFile(fname.c_str())) {
+                sink += feat.size();
+            }
+        }));
+    }
+
+    if (selected("match_features") or selected("hash_features")) {
+        Generator gen(SEED + 2U);
+        // Every fourth path is a feature; documents hold random subsets
+        std::set<std::string> features;
+        for (unsigned int i = 0U; i < cached.size(); i += 4U) {
+            features.insert(cached[i]);
+        }
+        const unsigned int NDOCS = 100U * SCALE;
+        std::vector<std::string> docs;
+        unsigned long nlines = 0UL;
+        for (unsigned int d = 0U; d < NDOCS; d++) {
+            std::stringstream ss;
+            for (const auto &p : cached) {
+                if (gen.uniform(20U) == 0U) {
+                    ss << p << ' ' << (1U + gen.uniform(100U)) << '\n';
+                    nlines++;
+                }
+            }
+            docs.push_back(ss.str());
+        }
+        if (selected("match_features")) {
+            results.push_back(measure("match_features", nlines, RUNS, [&]() {
+                sparsevector v;
+                for (const auto &doc : docs) {
+                    std::stringstream in(doc);
+                    match_features(in, features, v);
+                    sink += v.size();
+                }
+            }));
+        }
+        if (selected("hash_features")) {
+            results.push_back(measure("hash_features", nlines, RUNS, [&]() {
+                sparsevector v;
+                HashStats stats;
+                for (const auto &doc : docs) {
+                    std::stringstream in(doc);
+                    hash_features(in, 1U << 18, 0U, true, v, stats);
+                    sink += v.size();
+                }
+            }));
+        }
+    }
+
+    if (selected("path_map") or selected("path_table")) {
+        Generator gen(SEED + 4U);
+        // Path occurrences of a large document: few distinct paths, most
+        // of them repeated many times
+        const std::vector<std::string> distinct(gen.sorted_paths(5000U));
+        const unsigned int NOCCURRENCES = 1200000U * SCALE;
+        std::vector<const std::string *> occurrences;
+        for (unsigned int i = 0U; i < NOCCURRENCES; i++) {
+            const unsigned int r = gen.uniform(distinct.size());
+            occurrences.push_back(&distinct[gen.uniform(r + 1U)]);
+        }
+        // Both aggregate the occurrences and emit the sorted counts
+        auto with_map = [&]() {
+            std::map<std::string, unsigned int> paths;
+            for (const std::string *p : occurrences) {
+                paths[*p] += 1U;
+            }
+            std::stringstream out;
+            for (const auto &p : paths) {
+                out << p.first << ' ' << p.second << '\n';
+            }
+            return out.str();
+        };
+        auto with_table = [&]() {
+            PathTable<unsigned int> paths;
+            for (const std::string *p : occurrences) {
+                paths.get(*p, 0U) += 1U;
+            }
+            std::stringstream out;
+            paths.for_each_sorted([&out](const std::string &p, unsigned int n) {
+                out << p << ' ' << n << '\n';
+            });
+            return out.str();
+        };
+        if (with_map() != with_table()) {
+            throw "PathTable output differs from std::map output.";
+        }
+        if (selected("path_map")) {
+            results.push_back(measure("path_map", NOCCURRENCES, RUNS, [&]() {
+                sink += with_map().size();
+            }));
+        }
+        if (selected("path_table")) {
+            results.push_back(measure("path_table", NOCCURRENCES, RUNS, [&]() {
+                sink += with_table().size();
+            }));
+        }
+    }
+
+    if (selected("read_files")) {
+        Generator gen(SEED + 4U);
+        // Many small cache files. They stay in the page cache, so this
+        // measures the overhead of the readers rather than the device.
+        const unsigned int NFILES = 500U * SCALE;
+        std::vector<std::string> names;
+        unsigned long nbytes = 0UL;
+        for (unsigned int i = 0U; i < NFILES; i++) {
+            std::stringstream ss;
+            ss << TMPDIR << "/cache" << i;
+            names.push_back(ss.str());
+            std::ofstream out(names.back(), std::ios::binary);
+            for (const auto &p : cached) {
+                if (gen.uniform(20U) == 0U) {
+                    out << p << ' ' << 1 << '\n';
+                }
+            }
+            nbytes += out.tellp();
+            tmpfiles.push_back(names.back());
+        }
+        results.push_back(measure("read_files_ifstream", nbytes, RUNS, [&]() {
+            for (const auto &name : names) {
+                std::ifstream in(name, std::ios::binary);
+                std::stringstream ss;
+                ss << in.rdbuf();
+                sink += ss.str().size();
+            }
+        }));
+        results.push_back(measure("read_files_async", nbytes, RUNS, [&]() {
+            AsyncReader reader(names, 64U);
+            ReadBuffer buf;
+            while (reader.next(buf)) {
+                sink += buf.data.size();
+            }
+        }));
+    }
+
+    if (selected("value_stats")) {
+        Generator gen(SEED + 3U);
+        // Values of a few paths with many occurrences, like long arrays
+        const unsigned int NVALUES = 1000000U * SCALE;
+        std::vector<double> values;
+        for (unsigned int i = 0U; i < NVALUES; i++) {
+            values.push_back(gen.uniform(1000U) / 10.0);
+        }
+        results.push_back(measure("value_stats", NVALUES, RUNS, [&]() {
+            ValueStats stats[8];
+            for (unsigned int i = 0U; i < NVALUES; i++) {
+                stats[i % 8U].add(values[i]);
+            }
+            for (auto &st : stats) {
+                sink += st.median() > 0.0;
+            }
+        }));
+    }
+
+    if (selected("score_linear") or selected("score_trees")) {
+        Generator gen(SEED + 5U);
+        // Hashed vectors of 500 features out of 2^18
+        const unsigned int DIM = 1U << 18;
+        const unsigned int NVECTORS = 2000U * SCALE;
+        std::vector<sparsevector> vectors(NVECTORS);
+        unsigned long nfeatures = 0UL;
+        for (auto &v : vectors) {
+            std::set<unsigned int> indices;
+            while (indices.size() < 500U) {
+                indices.insert(1U + gen.uniform(DIM));
+            }
+            for (const unsigned int i : indices) {
+                v.push_back({i, 1.0 + gen.uniform(100U)});
+            }
+            nfeatures += v.size();
+        }
+        if (selected("score_linear")) {
+            const std::string fname(TMPDIR + "/linear.model");
+            std::ofstream out(fname, std::ios::trunc);
+            out << "linear\nbias -1\n";
+            for (unsigned int i = 1U; i <= DIM; i += 1U + gen.uniform(4U)) {
+                out << i << ' ' << (gen.uniform(2001U) / 1000.0 - 1.0) << '\n';
+            }
+            out.close();
+            tmpfiles.push_back(fname);
+            const Model model(fname.c_str());
+            results.push_back(measure("score_linear", nfeatures, RUNS, [&]() {
+                for (const auto &v : vectors) {
+                    sink += model.score(v) > 0.0;
+                }
+            }));
+        }
+        if (selected("score_trees")) {
+            // 100 complete trees of depth 6
+            const std::string fname(TMPDIR + "/trees.model");
+            std::ofstream out(fname, std::ios::trunc);
+            out << "trees\n";
+            for (unsigned int t = 0U; t < 100U; t++) {
+                out << "tree\n";
+                for (unsigned int n = 0U; n < 127U; n++) {
+                    if (n < 63U) {
+                        out << "split " << (1U + gen.uniform(DIM)) << ' '
+                            << gen.uniform(50U) << ' ' << (2U * n + 1U) << ' '
+                            << (2U * n + 2U) << '\n';
+                    } else {
+                        out << "leaf " << (gen.uniform(201U) / 100.0 - 1.0)
+                            << '\n';
+                    }
+                }
+            }
+            out.close();
+            tmpfiles.push_back(fname);
+            const Model model(fname.c_str());
+            results.push_back(measure("score_trees", NVECTORS, RUNS, [&]() {
+                for (const auto &v : vectors) {
+                    sink += model.score(v) > 0.0;
+                }
+            }));
+        }
+    }
+
+    for (const auto &f : tmpfiles) {
+        unlink(f.c_str());
+    }
+    rmdir(TMPDIR.c_str());
+
+    // Write results
+    std::ofstream ofile;
+    if (vm.count("output-file")) {
+        ofile.open(vm["output-file"].as<std::string>(),
+                   std::ios::binary | std::ios::trunc);
+        if (not ofile) {
+            throw "Unable to open the output file.";
+        }
+    }
+    std::ostream &out = vm.count("output-file") ? ofile : std::cout;
+    for (const auto &r : results) {
+        out << "{\"benchmark\":\"" << r.name << "\""
+            << ",\"seed\":" << SEED
+            << ",\"scale\":" << SCALE
+            << ",\"ops\":" << r.ops
+            << ",\"runs\":" << r.runs
+            << ",\"best_ms\":" << r.best_ms
+            << ",\"median_ms\":" << r.median_ms
+            << ",\"ns_per_op\":" << (r.best_ms * 1e6 / std::max(r.ops, 1UL))
+            << "}\n";
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+	try {
+		return run(argc, argv);
+	} catch (std::exception &e) {
+		std::cerr << "Exception caught: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	} catch (const char *e) {
+		std::cerr << "Exception caught: " << e << std::endl;
+		return EXIT_FAILURE;
+	} catch (...) {
+		std::cerr << "Unexpected exception caught." << std::endl;
+		return EXIT_FAILURE;
+	}
+}
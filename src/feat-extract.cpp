@@ -20,21 +20,34 @@
  *  Created on: Dec 10, 2013
  */
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include <unistd.h> // truncate()
+
 #include <boost/program_options.hpp>
 #include <boost/thread.hpp>	// boost::mutex
 #include <quickly/DataAction.h>
 #include <quickly/ThreadPool.h>
 
+#include "AsyncReader.h"
+#include "Model.h"
 #include "NPPFFile.h"
-#include "pdfpath.h"
+#include "PathIndex.h"
+#include "Telemetry.h"
+#include "featmatch.h"
+#include "shard.h"
+#include "trace.h"
 
 namespace po = boost::program_options;
 
@@ -55,8 +68,22 @@ private:
     static std::ofstream out_file;
     // Use values as features
     static bool use_values;
+    // Finished lines waiting for the lines of preceding files
+    static std::map<unsigned int, std::string> pending;
+    // The index of the next file to write out
+    static unsigned int next_id;
+    // The dimension of hashed feature vectors, 0 if features are matched
+    static unsigned int hash_dim;
+    // The seed of the feature hash function
+    static std::uint64_t hash_seed;
+    // Collision statistics of all hashed vectors
+    static HashStats hash_stats;
+    // The model scoring the vectors, if scores are output
+    static const Model *model;
+    // The live counters of the status file, if any
+    static Telemetry *telemetry;
 
-    bool process(const std::string &line);
+    void process(const std::string &line);
 public:
     // Dummy constructor
     DataActionImpl() :
@@ -72,8 +99,40 @@ public:
     // Static constructor
     static void init(const std::string &nppf_name,
                      const std::string &out_file,
-                     filevector all_files,
-                     bool use_values);
+                     bool use_values,
+                     bool append = false);
+    // Sets the files to process next, whose IDs start from 0
+    static void setFiles(filevector &files) {
+        all_files.swap(files);
+        next_id = 0U;
+    }
+    static const filevector &getFiles() {
+        return all_files;
+    }
+    // Hashes all paths into vectors of dimension dim instead of matching
+    // them against a feature set, adding to the statistics of the files
+    // hashed before
+    static void init_hashing(unsigned int dim, std::uint64_t seed,
+                             const HashStats &done) {
+        hash_dim = dim;
+        hash_seed = seed;
+        hash_stats = done;
+    }
+    static const HashStats &getHashStats() {
+        return hash_stats;
+    }
+    // Outputs the scores of the vectors by a model instead of the vectors
+    static void init_model(const Model *model) {
+        DataActionImpl::model = model;
+    }
+    // Counts the finished files in the status file
+    static void init_telemetry(Telemetry *telemetry) {
+        DataActionImpl::telemetry = telemetry;
+    }
+    // Writes out the lines of all files finished so far
+    static void finish();
+    // Extracts the vectors of all files from an inverted path index
+    static void extract_index(const std::string &index_name);
 
     // Overridden doFull() method
     virtual void doFull(std::stringstream &databuf);
@@ -84,81 +143,169 @@ filevector DataActionImpl::all_files;
 std::set<std::string> DataActionImpl::features;
 std::ofstream DataActionImpl::out_file;
 bool DataActionImpl::use_values;
+std::map<unsigned int, std::string> DataActionImpl::pending;
+unsigned int DataActionImpl::next_id = 0U;
+unsigned int DataActionImpl::hash_dim = 0U;
+std::uint64_t DataActionImpl::hash_seed = 0U;
+HashStats DataActionImpl::hash_stats;
+const Model *DataActionImpl::model = nullptr;
+Telemetry *DataActionImpl::telemetry = nullptr;
 
 void DataActionImpl::init(const std::string &nppf_name,
                           const std::string &out_file,
-                          filevector all_files,
-                          bool use_values) {
-    for (const auto &feat : InNPPFFile(nppf_name.c_str())) {
-        DataActionImpl::features.insert(feat);
+                          bool use_values,
+                          bool append) {
+    if (not nppf_name.empty()) {
+        for (const auto &feat : InNPPFFile(nppf_name.c_str())) {
+            DataActionImpl::features.insert(feat);
+        }
     }
-    DataActionImpl::out_file.open(out_file, std::ios::binary | std::ios::trunc);
-    DataActionImpl::all_files = all_files;
+    DataActionImpl::out_file.open(out_file, std::ios::binary |
+                                  (append ? std::ios::app : std::ios::trunc));
     DataActionImpl::use_values = use_values;
 }
 
-bool DataActionImpl::process(const std::string &line) {
-    if (line.size() > 0) {
+/*
+ * Lines are written in the order of the input files, so that the outputs
+ * of shards can be concatenated into the output of the whole data set.
+ */
+void DataActionImpl::process(const std::string &line) {
     boost::mutex::scoped_lock lock(DataActionImpl::mutex);
-        DataActionImpl::out_file << line << std::endl;
+    pending[getId()] = line;
+    std::map<unsigned int, std::string>::iterator it;
+    while ((it = pending.begin()) != pending.end() and it->first == next_id) {
+        DataActionImpl::out_file << it->second << '\n';
+        pending.erase(it);
+        next_id++;
     }
-    return true;
+    DataActionImpl::out_file.flush();
 }
 
-void DataActionImpl::doFull(std::stringstream &databuf) {
-    std::set<std::string>::const_iterator fi = DataActionImpl::features.begin();
-    std::string path;
-    std::stringstream ss;
-    // Write file class
-    ss << DataActionImpl::all_files[getId()].second << ' ';
-    // Parse paths
-    while (databuf.good() and databuf.peek() != EOF) {
-        path = get_pdfpath_string(databuf);
-        // Remove the space delimiter
-        databuf.get();
-        // Get the path value
-        double val;
-        databuf >> val;
-        // Remove the trailing space
-        databuf.get();
-        if (path < *fi) {
-            continue;
-        } else if (path > *fi) {
-            do {
-                fi++;
-                if (fi == features.end()) {
-                    goto end_of_features;
-                }
-            } while (path > *fi);
+/*
+ * Files whose child processes failed leave gaps, which are filled with
+ * comment lines, so that the output keeps the order of the input files
+ * and --resume does not retry them.
+ */
+void DataActionImpl::finish() {
+    for (unsigned int id = next_id; id < all_files.size(); id++) {
+        const auto it = pending.find(id);
+        if (it != pending.end()) {
+            DataActionImpl::out_file << it->second << '\n';
+        } else {
+            DataActionImpl::out_file << '#' << all_files[id].second
+                                     << " failed #" << all_files[id].first
+                                     << '\n';
         }
-        if (path == *fi) {
-            // Write feature
-            ss << (std::distance(features.begin(), fi) + 1U) << ':';
-            if (use_values) {
-                ss << val << ' ';
-            } else {
-                ss << "1 ";
-            }
+    }
+    pending.clear();
+    next_id = all_files.size();
+    DataActionImpl::out_file.flush();
+}
+
+/*
+ * The index is read once, in path order. Every feature appends its value
+ * to the vectors of the documents in its posting list. Features are
+ * visited in increasing index order, so the vectors come out sorted.
+ */
+void DataActionImpl::extract_index(const std::string &index_name) {
+    PathIndex index(index_name.c_str());
+    if (use_values and not index.hasValues()) {
+        throw "The index holds no values, rebuild it with pathcount "
+              "--values.";
+    }
+    const std::vector<std::string> &documents = index.getDocuments();
+    std::unordered_map<std::string, unsigned int> ids;
+    for (unsigned int i = 0U; i < documents.size(); i++) {
+        ids.emplace(documents[i], i);
+    }
+    // The document ID of every file, UINT_MAX if it is not in the index
+    std::vector<unsigned int> file_ids;
+    std::vector<bool> wanted(documents.size(), false);
+    unsigned int missing = 0U;
+    for (const auto &file : all_files) {
+        const auto it = ids.find(file.first);
+        if (it == ids.end()) {
+            file_ids.push_back(UINT_MAX);
+            missing++;
+        } else {
+            file_ids.push_back(it->second);
+            wanted[it->second] = true;
+        }
+    }
+    if (missing > 0U) {
+        std::cerr << missing << " files are not in the index and are "
+                  << "skipped." << std::endl;
+    }
+
+    std::vector<sparsevector> vectors(documents.size());
+    std::vector<std::pair<unsigned int, double> > postings;
+    std::set<std::string>::const_iterator fi = features.begin();
+    // The feature index of fi
+    unsigned int findex = 1U;
+    while (fi != features.end() and index.next()) {
+        while (fi != features.end() and *fi < index.path()) {
             fi++;
-            if (fi == features.end()) {
-                goto end_of_features;
+            findex++;
+        }
+        if (fi == features.end() or *fi != index.path()) {
+            continue;
+        }
+        index.postings(postings);
+        for (const auto &p : postings) {
+            if (p.first < wanted.size() and wanted[p.first]) {
+                vectors[p.first].push_back({findex, p.second});
             }
         }
+        fi++;
+        findex++;
     }
-    end_of_features:
 
-    // Write file name as comment
-    ss << '#' << DataActionImpl::all_files[getId()].first;
-    // Do not write empty lines
-    while (not this->process(ss.str())) {
+    for (unsigned int i = 0U; i < all_files.size(); i++) {
+        if (file_ids[i] == UINT_MAX) {
+            continue;
+        }
+        std::stringstream ss;
+        write_output_line(ss, all_files[i].second, vectors[file_ids[i]],
+                          use_values, model, all_files[i].first);
+        out_file << ss.str() << '\n';
     }
+    out_file.flush();
+    // Files missing from the index leave no gaps for finish() to fill
+    next_id = all_files.size();
+}
+
+void DataActionImpl::doFull(std::stringstream &databuf) {
+    HIDOST_TRACE1(action_start, getId());
+    const std::size_t nbytes = databuf.rdbuf()->in_avail();
+    sparsevector v;
+    if (hash_dim > 0U) {
+        HashStats stats;
+        hash_features(databuf, hash_dim, hash_seed, use_values, v, stats);
+        boost::mutex::scoped_lock lock(DataActionImpl::mutex);
+        hash_stats.add(stats);
+    } else {
+        match_features(databuf, DataActionImpl::features, v);
+    }
+
+    std::stringstream ss;
+    // Hashed values are signed sums, even without --values
+    write_output_line(ss, DataActionImpl::all_files[getId()].second, v,
+                      use_values or hash_dim > 0U, model,
+                      DataActionImpl::all_files[getId()].first);
+    const std::string line = ss.str();
+    this->process(line);
+    if (telemetry != nullptr) {
+        telemetry->job_done(nbytes, line.size() + 1U);
+    }
+    HIDOST_TRACE1(action_done, getId());
 }
 
 po::variables_map parse_arguments(int argc, char *argv[]) {
     po::options_description desc(
             "This program extracts PDF structural features from cached "
             "files specified in the input file according to the feature "
-            "(NPPF) file and stores them in libsvm format in the output "
+            "(NPPF) file, or by hashing all paths into a fixed number of "
+            "features, and stores them in libsvm format in the output "
             "file. Allowed options");
     desc.add_options()
             ("help", "produce help message")
@@ -169,9 +316,22 @@ po::variables_map parse_arguments(int argc, char *argv[]) {
                     po::value<std::string>()->required(),
                     "a list of benign path files, one per line")
             ("features,f",
-                    po::value<std::string>()->required(),
+                    po::value<std::string>(),
                     "an NPPF file containing the list of features to extract")
+            ("hash-dim,H",
+                    po::value<unsigned int>(),
+                    "instead of using an NPPF file, hash every path into one "
+                    "of this many features, adding or subtracting its value "
+                    "depending on the hash")
+            ("hash-seed",
+                    po::value<unsigned long>()->default_value(0UL),
+                    "the seed of the hash function for --hash-dim")
             ("values", "use values instead of presence as features")
+            ("model",
+                    po::value<std::string>(),
+                    "score every vector with the linear or tree ensemble "
+                    "model in this file and write lines of the form "
+                    "'<class> <score> #<file>' instead of the vectors")
             ("vm-limit,M",
                     po::value<unsigned int>()->default_value(0U),
                     "limit the virtual memory of child processes in MB "
@@ -186,7 +346,36 @@ po::variables_map parse_arguments(int argc, char *argv[]) {
             ("parallel,N",
                     po::value<unsigned int>()->default_value(0U),
                     "number of child processes to run in parallel "
-                    "(default: number of cores minus one)");
+                    "(default: number of cores minus one)")
+            ("async-io", "read the input files in this process with many "
+                    "reads in flight, instead of through child processes; "
+                    "--vm-limit and --cpu-time do not apply")
+            ("io-depth",
+                    po::value<unsigned int>()->default_value(64U),
+                    "the number of files read at once with --async-io")
+            ("window,W",
+                    po::value<unsigned int>()->default_value(100000U),
+                    "the number of input files submitted to the child "
+                    "processes at a time, so that long lists need little "
+                    "memory; 0 submits all files at once")
+            ("index,x",
+                    po::value<std::string>(),
+                    "assemble the vectors from this inverted path index, "
+                    "built by pathcount --index, instead of reading the "
+                    "path files; requires --features")
+            ("resume", "keep the vectors already in the output file and "
+                    "only extract the files missing from it; files that "
+                    "failed are not retried")
+            ("shard",
+                    po::value<std::string>(),
+                    "only extract shard i/n of the input files, i.e., the "
+                    "i-th of n contiguous blocks (0 <= i < n) of the "
+                    "malicious followed by the benign files")
+            ("status",
+                    po::value<std::string>(),
+                    "write live counters of the worker pools, such as "
+                    "busy workers, finished files and the ETA, as a JSON "
+                    "object to this file every second");
 
     po::variables_map vm;
     po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
@@ -205,39 +394,169 @@ po::variables_map parse_arguments(int argc, char *argv[]) {
     return vm;
 }
 
-void get_input_files(filevector &input_files, const char *in_name,
-                     bool data_class) {
+/*
+ * Reads the list of malicious files followed by the list of benign files,
+ * restricted to a shard, a window of files at a time, so that the lists
+ * never need to be held in memory at once. The lists are only counted in
+ * advance when there are several shards, to find the range of this one.
+ */
+class InputLists {
+private:
+    std::ifstream mal;
+    std::ifstream ben;
+    // The range of the shard in the concatenated lists
+    std::size_t begin;
+    std::size_t end;
+    // The number of lines read so far
+    std::size_t pos;
+
+    static std::size_t count_lines(const std::string &name) {
+        std::ifstream in(name, std::ios::binary);
+        std::string line;
+        std::size_t n = 0U;
+        while (std::getline(in, line)) {
+            n++;
+        }
+        return n;
+    }
+public:
+    InputLists(const std::string &mal_name, const std::string &ben_name,
+               const Shard &shard) :
+            mal(mal_name, std::ios::binary), ben(ben_name, std::ios::binary),
+            begin(0U), end(SIZE_MAX), pos(0U) {
+        if (shard.count > 1U) {
+            shard.range(count_lines(mal_name) + count_lines(ben_name), begin,
+                        end);
+        }
+    }
+
+    /*!
+     * \brief Appends the next n files, or all remaining ones if n is 0,
+     * to files. Returns false if there are none left.
+     */
+    bool read(filevector &files, std::size_t n) {
+        std::string line;
+        std::size_t added = 0U;
+        while (pos < end and (n == 0U or added < n)) {
+            const bool malicious = static_cast<bool>(std::getline(mal, line));
+            if (not malicious and not std::getline(ben, line)) {
+                break;
+            }
+            if (pos++ >= begin) {
+                files.push_back({line, malicious});
+                added++;
+            }
+        }
+        return added > 0U;
+    }
+};
+
+/*
+ * Reads the files whose vectors are already in the output file. Every
+ * complete line of the output file ends with a comment holding the file
+ * name, so the output file itself serves as the journal of finished
+ * inputs. Failed files are finished too, their lines start with '#'
+ * and their class. Lines after the first max_lines ones and a trailing
+ * incomplete line are cut off.
+ */
+void read_finished_files(const std::string &out_name,
+                         std::multiset<std::pair<std::string, bool> > &finished,
+                         std::size_t max_lines) {
+    std::ifstream in(out_name, std::ios::binary);
     std::string line;
-    std::ifstream ifile(in_name, std::ios::binary);
-    while (std::getline(ifile, line)) {
-        input_files.push_back(std::pair<std::string, bool>(line, data_class));
+    std::streamoff complete = 0;
+    while (finished.size() < max_lines and std::getline(in, line)
+           and not in.eof()) {
+        complete += line.size() + 1;
+        const bool failed = not line.empty() and line[0] == '#';
+        const std::string::size_type hash = line.find('#', failed ? 1U : 0U);
+        if (line.size() < 2U or hash == std::string::npos) {
+            throw "Unable to resume, malformed line in the output file.";
+        }
+        finished.insert({line.substr(hash + 1), line[failed ? 1 : 0] == '1'});
     }
-    ifile.close();
+    in.close();
+    if (truncate(out_name.c_str(), complete) != 0 and complete > 0) {
+        throw "Unable to resume, cannot truncate the output file.";
+    }
+    std::cerr << "Resuming, " << finished.size() << " files already done."
+              << std::endl;
 }
 
-int run(int argc, char *argv[]) {
-    // Parse arguments
-    po::variables_map vm = parse_arguments(argc, argv);
-    const std::string INPUT_MAL = vm["input-mal"].as<std::string>();
-    const std::string INPUT_BEN = vm["input-ben"].as<std::string>();
-    const std::string NPPF_FILE = vm["features"].as<std::string>();
-    const bool USE_VALUES = vm.count("values") > 0;
-    const std::string OUTPUT_FILE = vm["output-file"].as<std::string>();
-    const unsigned int VM_LIMIT = vm["vm-limit"].as<unsigned int>();
-    const unsigned int CPU_LIMIT = vm["cpu-time"].as<unsigned int>();
-    const unsigned int PARALLEL = vm["parallel"].as<unsigned int>();
+/*
+ * Removes the finished files from files, and from finished, so that a
+ * file listed twice is only skipped as often as it was finished.
+ */
+void skip_finished_files(filevector &files,
+                         std::multiset<std::pair<std::string, bool> > &finished) {
+    if (finished.empty()) {
+        return;
+    }
+    filevector remaining;
+    for (const auto &file : files) {
+        auto it = finished.find(file);
+        if (it == finished.end()) {
+            remaining.push_back(file);
+        } else {
+            finished.erase(it);
+        }
+    }
+    files.swap(remaining);
+}
 
-    // Read file list
-    filevector input_files;
-    get_input_files(input_files, INPUT_MAL.c_str(), true);
-    get_input_files(input_files, INPUT_BEN.c_str(), false);
-    DataActionImpl::init(NPPF_FILE, OUTPUT_FILE, input_files, USE_VALUES);
+/*
+ * Reads the input files with an AsyncReader and extracts their vectors
+ * in parallel threads, in place of the child processes.
+ */
+void extract_async(const filevector &input_files, unsigned int parallel,
+                   unsigned int depth, Telemetry *telemetry) {
+    std::vector<std::string> names;
+    names.reserve(input_files.size());
+    for (const auto &file : input_files) {
+        names.push_back(file.first);
+    }
+    if (parallel == 0U) {
+        parallel = std::max(boost::thread::hardware_concurrency(), 2U) - 1U;
+    }
+    std::cerr << "Reading " << names.size() << " files with "
+              << AsyncReader::backend() << ", up to " << depth
+              << " at once." << std::endl;
 
+    AsyncReader reader(names, depth);
+    DataActionImpl dummy;
+    Telemetry::PoolScope scope(telemetry, names.size(), parallel, false);
+    boost::thread_group threads;
+    for (unsigned int i = 0U; i < parallel; i++) {
+        threads.create_thread([&reader, &dummy, &names]() {
+            ReadBuffer buf;
+            while (reader.next(buf)) {
+                if (not buf.ok) {
+                    std::cerr << "Unable to read " << names[buf.index]
+                              << std::endl;
+                    continue;
+                }
+                std::stringstream databuf(buf.data);
+                std::unique_ptr<DataActionImpl> action(
+                        dummy.create(buf.index));
+                action->doFull(databuf);
+            }
+        });
+    }
+    threads.join_all();
+}
+
+/*
+ * Extracts the vectors of the files in child processes, which read the
+ * files for the data action.
+ */
+void extract_children(const filevector &files, unsigned int parallel,
+                      unsigned int vm_limit, unsigned int cpu_limit,
+                      Telemetry *telemetry) {
     // Construct a vector of command-line arguments
     std::vector<const char * const *> argvs;
     const char prog_name[] = "/bin/cat";
     const char *pn = prog_name;
-    for (const auto &file : input_files) {
+    for (const auto &file : files) {
         const char **argv = (const char **) NULL;
         try {
             argv = new const char *[3]{pn, file.first.c_str(), nullptr};
@@ -249,16 +568,127 @@ int run(int argc, char *argv[]) {
 
     // Prepare the data action and perform scan
     DataActionImpl dummy;
-    quickly::ThreadPool pool(pn, argvs, &dummy, PARALLEL);
+    quickly::ThreadPool pool(pn, argvs, &dummy, parallel);
     pool.setVerbosity(5U);
-    pool.setVmLimit(VM_LIMIT * 1024U * 1024U);
-    pool.setCpuLimit(CPU_LIMIT);
-    pool.run();
+    pool.setVmLimit(vm_limit * 1024U * 1024U);
+    pool.setCpuLimit(cpu_limit);
+    {
+        Telemetry::PoolScope scope(telemetry, argvs.size(), parallel);
+        pool.run();
+    }
 
-    // Print results, delete command-line arguments
+    // Delete command-line arguments
     for (unsigned int i = 0U; i < argvs.size(); i++) {
         delete[] argvs[i];
     }
+}
+
+int run(int argc, char *argv[]) {
+    // Parse arguments
+    po::variables_map vm = parse_arguments(argc, argv);
+    const std::string INPUT_MAL = vm["input-mal"].as<std::string>();
+    const std::string INPUT_BEN = vm["input-ben"].as<std::string>();
+    const std::string NPPF_FILE = vm.count("features") ?
+            vm["features"].as<std::string>() : "";
+    const unsigned int HASH_DIM = vm.count("hash-dim") ?
+            vm["hash-dim"].as<unsigned int>() : 0U;
+    const std::uint64_t HASH_SEED = vm["hash-seed"].as<unsigned long>();
+    if (NPPF_FILE.empty() == (vm.count("hash-dim") == 0)) {
+        throw "Exactly one of --features and --hash-dim is required.";
+    }
+    if (vm.count("hash-dim") and HASH_DIM == 0U) {
+        throw "The hashing dimension must be positive.";
+    }
+    const bool USE_VALUES = vm.count("values") > 0;
+    const std::string INDEX_FILE = vm.count("index") ?
+            vm["index"].as<std::string>() : "";
+    if (not INDEX_FILE.empty() and HASH_DIM > 0U) {
+        throw "--index requires --features.";
+    }
+    std::unique_ptr<Model> model;
+    if (vm.count("model")) {
+        model.reset(new Model(vm["model"].as<std::string>().c_str()));
+        std::cerr << "Scoring with a model of " << model->size()
+                  << (model->is_linear() ? " weights." : " trees.")
+                  << std::endl;
+    }
+    const std::string OUTPUT_FILE = vm["output-file"].as<std::string>();
+    const unsigned int VM_LIMIT = vm["vm-limit"].as<unsigned int>();
+    const unsigned int CPU_LIMIT = vm["cpu-time"].as<unsigned int>();
+    const unsigned int PARALLEL = vm["parallel"].as<unsigned int>();
+    const bool ASYNC_IO = vm.count("async-io") > 0;
+    const unsigned int IO_DEPTH = vm["io-depth"].as<unsigned int>();
+    const bool RESUME = vm.count("resume") > 0;
+    const Shard SHARD = vm.count("shard") ?
+            Shard(vm["shard"].as<std::string>()) : Shard();
+    // The index and asynchronous reads take all files at once
+    const unsigned int WINDOW = INDEX_FILE.empty() and not ASYNC_IO ?
+            vm["window"].as<unsigned int>() : 0U;
+    std::unique_ptr<Telemetry> telemetry;
+    if (vm.count("status")) {
+        telemetry.reset(new Telemetry(vm["status"].as<std::string>(),
+                                      "feat-extract"));
+    }
+
+    InputLists lists(INPUT_MAL, INPUT_BEN, SHARD);
+    const std::string STATS_FILE = OUTPUT_FILE + ".hashstats";
+    std::multiset<std::pair<std::string, bool> > finished;
+    // The number of files hashed so far and their collision statistics
+    std::size_t nfiles = 0U;
+    HashStats hashed;
+    if (RESUME) {
+        // The statistics are written after every window. Only the vectors
+        // they cover are kept, so that every file is counted once.
+        unsigned int dim = HASH_DIM;
+        std::uint64_t seed = HASH_SEED;
+        if (HASH_DIM > 0U
+            and read_hash_stats(STATS_FILE, dim, seed, nfiles, hashed)
+            and (dim != HASH_DIM or seed != HASH_SEED)) {
+            throw "Unable to resume with a different hashing dimension or "
+                  "seed.";
+        }
+        read_finished_files(OUTPUT_FILE, finished,
+                            HASH_DIM > 0U ? nfiles : SIZE_MAX);
+        if (finished.size() < nfiles) {
+            throw "Unable to resume, the output file has fewer lines than "
+                  "its hashing statistics count.";
+        }
+    }
+    DataActionImpl::init(NPPF_FILE, OUTPUT_FILE, USE_VALUES, RESUME);
+    DataActionImpl::init_hashing(HASH_DIM, HASH_SEED, hashed);
+    DataActionImpl::init_model(model.get());
+    DataActionImpl::init_telemetry(telemetry.get());
+
+    // Process the file lists a window at a time, so that only the argument
+    // vectors of a window are held in memory
+    filevector files;
+    while (lists.read(files, WINDOW)) {
+        skip_finished_files(files, finished);
+        if (files.empty()) {
+            continue;
+        }
+        nfiles += files.size();
+        DataActionImpl::setFiles(files);
+        files.clear();
+        const filevector &window = DataActionImpl::getFiles();
+        if (not INDEX_FILE.empty()) {
+            DataActionImpl::extract_index(INDEX_FILE);
+        } else if (ASYNC_IO) {
+            extract_async(window, PARALLEL, IO_DEPTH, telemetry.get());
+        } else {
+            extract_children(window, PARALLEL, VM_LIMIT, CPU_LIMIT,
+                             telemetry.get());
+        }
+        DataActionImpl::finish();
+        if (HASH_DIM > 0U) {
+            write_hash_stats(STATS_FILE, HASH_DIM, HASH_SEED, nfiles,
+                             DataActionImpl::getHashStats(), false);
+        }
+    }
+    if (HASH_DIM > 0U) {
+        write_hash_stats(STATS_FILE, HASH_DIM, HASH_SEED, nfiles,
+                         DataActionImpl::getHashStats());
+    }
 
     return EXIT_SUCCESS;
 }
@@ -24,11 +24,18 @@
  * This program reads a list of paths and their counts from the specified input
  * file and writes a list of paths with count greater than the specified N,
  * sorted by name, in the NPPF format in the specified output file.
+ *
+ * Paths counted per class by pathcount can additionally be selected by
+ * their per-class counts or by the difference between the largest and
+ * the smallest fraction of files of a class they appear in.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
 #include <fstream>
+#include <sstream>
+#include <vector>
 
 #include <boost/program_options.hpp>
 
@@ -41,18 +48,85 @@ void exit_error(const char *e) {
     std::exit(EXIT_FAILURE);
 }
 
+// Selection criteria
+struct Criteria {
+    // Minimal total count
+    unsigned int min_count;
+    // Minimal count in at least one class
+    unsigned int min_class_count;
+    // Minimal difference between the largest and the smallest fraction
+    // of files of a class containing the path, if positive
+    double min_score;
+    // Number of files of each class
+    std::vector<unsigned long> class_files;
+};
+
+/*
+ * Reads the number of files of each class from a classes file written by
+ * pathcount.
+ */
+std::vector<unsigned long> read_classes(const char *fname) {
+    std::ifstream in(fname, std::ios::binary);
+    if (not in) {
+        exit_error("Unable to read the classes file.");
+    }
+    std::vector<unsigned long> class_files;
+    unsigned long n;
+    std::string name;
+    while (in >> n and std::getline(in, name)) {
+        class_files.push_back(n);
+    }
+    return class_files;
+}
+
+bool selected(const std::vector<unsigned long> &counts, const Criteria &c) {
+    if (counts.empty() or counts[0] < c.min_count) {
+        return false;
+    }
+    const unsigned int nclasses = counts.size() - 1U;
+    if (c.min_class_count > 0U and (nclasses == 0U or
+            *std::max_element(counts.begin() + 1, counts.end())
+            < c.min_class_count)) {
+        return false;
+    }
+    if (c.min_score > 0.0) {
+        if (nclasses == 0U or c.class_files.size() != nclasses) {
+            exit_error("The class counts do not match the classes file.");
+        }
+        double min_frac = 1.0, max_frac = 0.0;
+        for (unsigned int i = 0; i < nclasses; i++) {
+            const double frac = c.class_files[i] == 0UL ? 0.0 :
+                    static_cast<double>(counts[i + 1]) / c.class_files[i];
+            min_frac = std::min(min_frac, frac);
+            max_frac = std::max(max_frac, frac);
+        }
+        if (max_frac - min_frac < c.min_score) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void feat_select(const char *in_name, const char *out_name,
-                 unsigned int min_count) {
+                 const Criteria &criteria) {
     std::ifstream in(in_name, std::ifstream::binary);
     std::ofstream out(out_name, std::ios::binary | std::ios::trunc);
 
     out << "NPPF" << '\0' << '\0' << '\n';
     pdfpath path;
-    unsigned int count;
+    std::string line;
+    std::vector<unsigned long> counts;
     while (in.good() and in.peek() != EOF) {
-        in >> path >> count;
-        in.get();
-        if (count >= min_count) {
+        in >> path;
+        // The total count, optionally followed by per-class counts
+        std::getline(in, line);
+        std::istringstream ss(line);
+        counts.clear();
+        unsigned long count;
+        while (ss >> count) {
+            counts.push_back(count);
+        }
+        if (selected(counts, criteria)) {
             out << path << std::endl;
         }
     }
@@ -71,7 +145,20 @@ po::variables_map parse_arguments(int argc, char *argv[]) {
                     "the NPPF output file to be created")
             ("min-count,m",
                     po::value<unsigned int>()->required(),
-                    "minimal path count to be included in the output");
+                    "minimal path count to be included in the output")
+            ("min-class-count,c",
+                    po::value<unsigned int>()->default_value(0U),
+                    "with per-class counts, minimal path count in at least "
+                    "one class")
+            ("min-score,s",
+                    po::value<double>()->default_value(0.0),
+                    "with per-class counts, minimal difference between the "
+                    "largest and the smallest fraction of the files of a "
+                    "class that contain the path")
+            ("classes",
+                    po::value<std::string>(),
+                    "the classes file of the per-class counts (default: the "
+                    "input file name followed by .classes)");
 
     po::variables_map vm;
     po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
@@ -94,9 +181,17 @@ int run(int argc, char *argv[]) {
     po::variables_map vm = parse_arguments(argc, argv);
     const std::string INPUT_FILE = vm["input-file"].as<std::string>();
     const std::string OUTPUT_FILE = vm["output-file"].as<std::string>();
-    const unsigned int MIN_COUNT = vm["min-count"].as<unsigned int>();
+    Criteria criteria;
+    criteria.min_count = vm["min-count"].as<unsigned int>();
+    criteria.min_class_count = vm["min-class-count"].as<unsigned int>();
+    criteria.min_score = vm["min-score"].as<double>();
+    if (criteria.min_score > 0.0) {
+        const std::string CLASSES_FILE = vm.count("classes") ?
+                vm["classes"].as<std::string>() : INPUT_FILE + ".classes";
+        criteria.class_files = read_classes(CLASSES_FILE.c_str());
+    }
 
-    feat_select(INPUT_FILE.c_str(), OUTPUT_FILE.c_str(), MIN_COUNT);
+    feat_select(INPUT_FILE.c_str(), OUTPUT_FILE.c_str(), criteria);
     return EXIT_SUCCESS;
 }
 
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * featmatch.cpp
+ */
+
+#include "featmatch.h"
+
+#include <algorithm>
+#include <cstdio> // rename()
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "pdfpath.h"
+
+void match_features(std::istream &in, const std::set<std::string> &features,
+                    sparsevector &v) {
+    v.clear();
+    std::set<std::string>::const_iterator fi = features.begin();
+    // The feature index of fi
+    unsigned int index = 1U;
+    std::string path;
+    while (fi != features.end() and in.good() and in.peek() != EOF) {
+        path = get_pdfpath_string(in);
+        // Remove the space delimiter
+        in.get();
+        // Get the path value
+        double val;
+        in >> val;
+        // Skip further values, e.g., aggregates, and the newline
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        while (*fi < path) {
+            fi++;
+            index++;
+            if (fi == features.end()) {
+                return;
+            }
+        }
+        if (path == *fi) {
+            v.push_back({index, val});
+            fi++;
+            index++;
+        }
+    }
+}
+
+std::uint64_t hash_path(const std::string &path, std::uint64_t seed) {
+    // FNV-1a from a seeded offset basis
+    std::uint64_t h = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+    for (const char c : path) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 1099511628211ULL;
+    }
+    // Finalizer of SplitMix64, so that all bits depend on all input bytes
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+void hash_features(std::istream &in, unsigned int dim, std::uint64_t seed,
+                   bool use_values, sparsevector &v, HashStats &stats) {
+    v.clear();
+    std::string path;
+    while (in.good() and in.peek() != EOF) {
+        path = get_pdfpath_string(in);
+        // Remove the space delimiter
+        in.get();
+        double val;
+        in >> val;
+        // Skip further values, e.g., aggregates, and the newline
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (not use_values) {
+            val = 1.0;
+        }
+        const std::uint64_t h = hash_path(path, seed);
+        // The index uses the low bits, the sign the highest bit
+        const unsigned int index = h % dim + 1U;
+        v.push_back({index, (h >> 63) ? -val : val});
+        stats.paths++;
+    }
+
+    // Sum up the values of equal indices
+    std::sort(v.begin(), v.end(),
+              [](const std::pair<unsigned int, double> &a,
+                 const std::pair<unsigned int, double> &b) {
+                  return a.first < b.first;
+              });
+    sparsevector::iterator out = v.begin();
+    for (sparsevector::iterator it = v.begin(); it != v.end();) {
+        std::pair<unsigned int, double> sum(*it++);
+        while (it != v.end() and it->first == sum.first) {
+            sum.second += it++->second;
+            stats.collisions++;
+        }
+        if (sum.second == 0.0) {
+            stats.cancelled++;
+        } else {
+            *out++ = sum;
+        }
+    }
+    v.erase(out, v.end());
+}
+
+void write_hash_stats(const std::string &fname, unsigned int dim,
+                      std::uint64_t seed, std::size_t nfiles,
+                      const HashStats &stats, bool summarize) {
+    const std::string tmpname(fname + ".tmp");
+    std::ofstream out(tmpname, std::ios::trunc);
+    out << "dimension " << dim << '\n'
+        << "seed " << seed << '\n'
+        << "files " << nfiles << '\n'
+        << "paths " << stats.paths << '\n'
+        << "collisions " << stats.collisions << '\n'
+        << "cancelled " << stats.cancelled << '\n';
+    out.close();
+    if (not out or std::rename(tmpname.c_str(), fname.c_str()) != 0) {
+        std::cerr << "Unable to write " << fname << std::endl;
+    }
+    if (not summarize) {
+        return;
+    }
+    std::cerr << "Hashed " << stats.paths << " paths, " << stats.collisions
+              << " collided, " << stats.cancelled << " features cancelled out."
+              << std::endl;
+}
+
+bool read_hash_stats(const std::string &fname, unsigned int &dim,
+                     std::uint64_t &seed, std::size_t &nfiles,
+                     HashStats &stats) {
+    std::ifstream in(fname);
+    if (not in) {
+        return false;
+    }
+    std::string dim_key, seed_key, files_key, paths_key, coll_key, canc_key;
+    in >> dim_key >> dim >> seed_key >> seed >> files_key >> nfiles
+       >> paths_key >> stats.paths >> coll_key >> stats.collisions
+       >> canc_key >> stats.cancelled;
+    if (not in or dim_key != "dimension" or seed_key != "seed"
+        or files_key != "files" or paths_key != "paths"
+        or coll_key != "collisions" or canc_key != "cancelled") {
+        throw "Malformed hashing statistics file.";
+    }
+    return true;
+}
+
+void write_libsvm_line(std::ostream &out, bool malicious,
+                       const sparsevector &v, bool use_values,
+                       const std::string &fname) {
+    // Write file class
+    out << malicious << ' ';
+    for (const auto &feat : v) {
+        out << feat.first << ':';
+        if (use_values) {
+            out << feat.second << ' ';
+        } else {
+            out << "1 ";
+        }
+    }
+    // Write file name as comment
+    out << '#' << fname;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * featmatch.h
+ */
+
+#ifndef FEATMATCH_H_
+#define FEATMATCH_H_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * A sparse feature vector: pairs of 1-based feature indices and values,
+ * sorted by index.
+ */
+typedef std::vector<std::pair<unsigned int, double> > sparsevector;
+
+/*!
+ * \brief Extracts a feature vector from a sorted list of paths.
+ *
+ * Every line of the input stream holds a path string, a space, a value
+ * and a newline, sorted by path. Further values after the first one are
+ * ignored. Paths present in the feature set are
+ * stored in the feature vector with their values.
+ *
+ * @param in the input stream.
+ * @param features the sorted set of features.
+ * @param v the resulting feature vector.
+ */
+void match_features(std::istream &in, const std::set<std::string> &features,
+                    sparsevector &v);
+
+/*!
+ * \brief Collision statistics of feature hashing.
+ */
+struct HashStats {
+    // Number of hashed paths
+    unsigned long paths;
+    // Number of paths hashed to an index already taken by another path
+    // of the same file
+    unsigned long collisions;
+    // Number of indices whose signed values summed up to zero
+    unsigned long cancelled;
+
+    HashStats() :
+            paths(0UL), collisions(0UL), cancelled(0UL) {
+    }
+    void add(const HashStats &other) {
+        paths += other.paths;
+        collisions += other.collisions;
+        cancelled += other.cancelled;
+    }
+};
+
+/*!
+ * \brief Returns a seeded 64-bit hash of a path string.
+ */
+std::uint64_t hash_path(const std::string &path, std::uint64_t seed);
+
+/*!
+ * \brief Extracts a feature vector of a fixed dimension by hashing paths.
+ *
+ * The input is read like in match_features(), but every path is a
+ * feature. Its index is its hash modulo the dimension, plus one, and its
+ * value is added to or subtracted from that index, depending on another
+ * bit of the hash. Signed accumulation keeps the colliding values
+ * unbiased. Indices whose values cancel out are left out of the vector.
+ *
+ * @param in the input stream.
+ * @param dim the dimension of the feature vector.
+ * @param seed the seed of the hash function.
+ * @param use_values if false, every path has the value 1.
+ * @param v the resulting feature vector.
+ * @param stats the collision statistics, which are updated.
+ */
+void hash_features(std::istream &in, unsigned int dim, std::uint64_t seed,
+                   bool use_values, sparsevector &v, HashStats &stats);
+
+/*!
+ * \brief Records the collision statistics of hashed vectors in a file
+ * and summarizes them on the standard error.
+ *
+ * The file is replaced atomically, so that it can be rewritten as the
+ * statistics grow.
+ *
+ * @param fname the name of the statistics file.
+ * @param dim the dimension of the feature vectors.
+ * @param seed the seed of the hash function.
+ * @param nfiles the number of hashed files.
+ * @param stats the collision statistics.
+ * @param summarize whether to summarize them on the standard error.
+ */
+void write_hash_stats(const std::string &fname, unsigned int dim,
+                      std::uint64_t seed, std::size_t nfiles,
+                      const HashStats &stats, bool summarize = true);
+
+/*!
+ * \brief Reads the collision statistics written by write_hash_stats().
+ *
+ * Returns false if the file cannot be read. Throws a const char * if it
+ * is malformed.
+ */
+bool read_hash_stats(const std::string &fname, unsigned int &dim,
+                     std::uint64_t &seed, std::size_t &nfiles,
+                     HashStats &stats);
+
+/*!
+ * \brief Writes a feature vector as a line in libsvm format.
+ *
+ * The line starts with the class label and ends with the file name as a
+ * comment. Without values, every feature has the value 1.
+ *
+ * @param out the output stream.
+ * @param malicious the class of the file.
+ * @param v the feature vector.
+ * @param use_values whether to write the values of the features.
+ * @param fname the name of the file.
+ */
+void write_libsvm_line(std::ostream &out, bool malicious,
+                       const sparsevector &v, bool use_values,
+                       const std::string &fname);
+
+#endif /* FEATMATCH_H_ */
@@ -26,61 +26,24 @@
  */
 
 #include <iostream>
-#include <cmath> // modf()
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
-#include <sstream>
 
 #include <stdlib.h>	// mkstemp()
-#include <unistd.h> // write(), close()
+#include <unistd.h> // fsync(), close()
 
-#include "pdfpath.h"
+#include "pathmerge.h"
 
 void exit_error(const char *e) {
     std::cerr << "merger: " << e << std::endl;
     std::exit(EXIT_FAILURE);
 }
 
-// If true, every path count read from the file will be treated as a one
-bool count_one = false;
-
-bool okstream(std::ifstream &s) {
-    return s.good() and s.peek() != EOF;
-}
-
-void read_line(std::ifstream &f, std::string &p, unsigned int &c) {
-    p = get_pdfpath_string(f);
-    double dc, dci;
-    f >> dc;
-    if (count_one) {
-        c = 1U;
-    } else {
-        std::modf(dc, &dci);
-        c = static_cast<unsigned int>(dci);
-    }
-    f.get();
-}
-
-void write_line(int fd, const std::string &p, unsigned int c) {
-    static std::stringstream ss;
-    ss << p << ' ' << c << '\n';
-    std::string buf(ss.str());
-    write(fd, buf.c_str(), buf.size());
-    ss.str("");
-}
-
-void copy_trailer(int fd, std::ifstream &f) {
-    std::string path;
-    while (okstream(f)) {
-        unsigned int count;
-        read_line(f, path, count);
-        write_line(fd, path, count);
-    }
-}
-
-void merge(const char *fname1, const char *fname2) {
+void merge(const char *fname1, const char *fname2, MergeMode mode,
+           unsigned int nclasses, unsigned int class1, unsigned int class2,
+           bool front_code) {
     std::ifstream f1(fname1, std::ios::binary), f2(fname2, std::ios::binary);
     char tmpname[] = "/tmp/mergerXXXXXX";
     int fd = mkstemp(tmpname);
@@ -88,66 +51,50 @@ void merge(const char *fname1, const char *fname2) {
         exit_error("mkstemp() problem");
     }
     std::cout << tmpname << std::endl;
-    std::string p1, p2;
-    unsigned int c1, c2;
-    bool do_read = true;
-
-    while (not do_read or (okstream(f1) and okstream(f2))) {
-        if (do_read) {
-            read_line(f1, p1, c1);
-            read_line(f2, p2, c2);
-        }
-        do_read = true;
-
-        if (p1 < p2) {
-            write_line(fd, p1, c1);
-            while (okstream(f1)) {
-                read_line(f1, p1, c1);
-                if (p1 < p2) {
-                    write_line(fd, p1, c1);
-                } else {
-                    do_read = false;
-                    break;
-                }
-            }
-        } else if (p2 < p1) {
-            write_line(fd, p2, c2);
-            while (okstream(f2)) {
-                read_line(f2, p2, c2);
-                if (p2 < p1) {
-                    write_line(fd, p2, c2);
-                } else {
-                    do_read = false;
-                    break;
-                }
-            }
-        }
-        if (p1 == p2) {
-            write_line(fd, p1, c1 + c2);
-            do_read = true;
-        }
+    try {
+        merge_paths(f1, f2, fd, mode, nclasses, class1, class2, front_code);
+    } catch (const char *e) {
+        exit_error(e);
+    }
+    // pathcount journals the result as durable once we exit
+    if (fsync(fd) or close(fd)) {
+        exit_error("Unable to write the result file.");
     }
-
-    copy_trailer(fd, f1);
-    copy_trailer(fd, f2);
-    close(fd);
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
+    if (argc != 4 and argc != 7) {
         exit_error("Wrong count of arguments.\n"
-                   "Usage: merger file1 file2 (1|n)");
+                   "Usage: merger file1 file2 (1|n|s)[f] "
+                   "[nclasses class1 class2]");
     }
 
+    // 1: count every path once, n: sum counts, s: subtract file2 from file1
+    MergeMode mode = MERGE_SUM;
     if (strncmp(argv[3], "1", 1) == 0) {
-        count_one = true;
+        mode = MERGE_COUNT_ONE;
     } else if (strncmp(argv[3], "n", 1) == 0) {
-        count_one = false;
+        mode = MERGE_SUM;
+    } else if (strncmp(argv[3], "s", 1) == 0) {
+        mode = MERGE_SUBTRACT;
     } else {
-        exit_error("Third argument must be either '1' or 'n'.");
+        exit_error("Third argument must be either '1', 'n' or 's'.");
+    }
+    // f: front-code the output, for intermediate files
+    const bool front_code = argv[3][1] == 'f';
+
+    // Per-class counting of path files, with classes of both files
+    unsigned int nclasses = 0U, class1 = 0U, class2 = 0U;
+    if (argc == 7) {
+        nclasses = std::strtoul(argv[4], NULL, 10);
+        class1 = std::strtoul(argv[5], NULL, 10);
+        class2 = std::strtoul(argv[6], NULL, 10);
+        if (nclasses == 0U or class1 >= nclasses or class2 >= nclasses) {
+            exit_error("Classes must be between 0 and nclasses-1.");
+        }
     }
 
-    merge(argv[1], argv[2]);
+    merge(argv[1], argv[2], mode, nclasses, class1, class2, front_code);
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * pathmerge.cpp
+ */
+
+#include "pathmerge.h"
+
+#include <algorithm>
+#include <cmath> // modf()
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h> // write()
+
+#include "pdfpath.h"
+#include "trace.h"
+
+typedef std::vector<long> counts;
+
+// The header line of front-coded files
+static const char FC_HEADER[] = "\0FC\n";
+static const std::string::size_type FC_HEADER_LEN = sizeof(FC_HEADER) - 1U;
+
+/*
+ * Reads the lines of a plain or front-coded path file.
+ */
+class PathReader {
+private:
+    std::istream &in;
+    bool front_coded;
+public:
+    // The path and counts of the current line
+    std::string path;
+    counts c;
+    // A lower bound of the length of the prefix shared with the path of
+    // the previous line
+    std::string::size_type shared;
+
+    explicit PathReader(std::istream &in);
+
+    /*
+     * Reads the next line and returns true, or returns false at the end
+     * of the file. In MERGE_COUNT_ONE mode, the counts are replaced by
+     * the given ones.
+     */
+    bool next(MergeMode mode, const counts &one);
+};
+
+PathReader::PathReader(std::istream &in) :
+        in(in), front_coded(false), path(), c(), shared(0U) {
+    if (in.good() and in.peek() == '\0') {
+        char header[FC_HEADER_LEN];
+        if (not in.read(header, FC_HEADER_LEN) or
+            std::memcmp(header, FC_HEADER, FC_HEADER_LEN) != 0) {
+            throw "pathmerge: Bad front-coded file header.";
+        }
+        front_coded = true;
+    }
+}
+
+bool PathReader::next(MergeMode mode, const counts &one) {
+    if (not (in.good() and in.peek() != EOF)) {
+        return false;
+    }
+    if (front_coded) {
+        // Parse the prefix length by hand, formatted input is too slow
+        std::string::size_type prefix = 0U;
+        int ch = in.get();
+        if (ch < '0' or ch > '9') {
+            throw "pathmerge: Malformed front-coded line.";
+        }
+        for (; ch >= '0' and ch <= '9'; ch = in.get()) {
+            prefix = prefix * 10U + static_cast<unsigned int>(ch - '0');
+        }
+        if (ch != ' ' or prefix > path.size()) {
+            throw "pathmerge: Malformed front-coded line.";
+        }
+        path.resize(prefix);
+        path += get_pdfpath_string(in);
+        shared = prefix;
+    } else {
+        path = get_pdfpath_string(in);
+        shared = 0U;
+    }
+    double dc, dci;
+    c.clear();
+    while (in.get() == ' ' and in >> dc) {
+        std::modf(dc, &dci);
+        c.push_back(static_cast<long>(dci));
+    }
+    if (mode == MERGE_COUNT_ONE) {
+        c = one;
+    }
+    return true;
+}
+
+/*
+ * Writes the lines of a plain or front-coded path file.
+ */
+class PathWriter {
+private:
+    int fd;
+    MergeMode mode;
+    bool front_coded;
+    // The path of the last line written
+    std::string last;
+    std::stringstream ss;
+public:
+    // Number of lines written
+    unsigned long lines;
+
+    PathWriter(int fd, MergeMode mode, bool front_coded) :
+            fd(fd), mode(mode), front_coded(front_coded), last(), ss(),
+            lines(0UL) {
+        if (front_coded) {
+            write(fd, FC_HEADER, FC_HEADER_LEN);
+        }
+    }
+
+    /*
+     * Writes a line, unless the counts make the path drop out.
+     */
+    void put(const std::string &p, const counts &c);
+};
+
+void PathWriter::put(const std::string &p, const counts &c) {
+    if (c.empty() or c[0] == 0L or (c[0] < 0L and mode != MERGE_SUBTRACT)) {
+        return;
+    }
+    if (front_coded) {
+        const std::string::size_type n = std::min(p.size(), last.size());
+        const std::string::size_type prefix =
+                std::mismatch(p.begin(), p.begin() + n, last.begin()).first
+                - p.begin();
+        ss << prefix << ' ';
+        ss.write(p.data() + prefix, p.size() - prefix);
+        last.assign(p);
+    } else {
+        ss << p;
+    }
+    for (const long n : c) {
+        ss << ' ' << n;
+    }
+    ss << '\n';
+    std::string buf(ss.str());
+    write(fd, buf.c_str(), buf.size());
+    ss.str("");
+    lines++;
+}
+
+/*
+ * Combines the counts of c2 into c1, element-wise.
+ */
+static void combine(counts &c1, const counts &c2, long sign2) {
+    if (c1.size() < c2.size()) {
+        c1.resize(c2.size(), 0L);
+    }
+    for (counts::size_type i = 0; i < c2.size(); i++) {
+        c1[i] += sign2 * c2[i];
+    }
+}
+
+/*
+ * Compares two paths known to share their first common bytes, like
+ * std::string::compare(). Sets common to the length of their shared
+ * prefix.
+ */
+static int compare_paths(const std::string &p1, const std::string &p2,
+                         std::string::size_type &common) {
+    const std::string::size_type n = std::min(p1.size(), p2.size());
+    while (common < n and p1[common] == p2[common]) {
+        common++;
+    }
+    if (common == n) {
+        return p1.size() < p2.size() ? -1 : (p1.size() > p2.size() ? 1 : 0);
+    }
+    return static_cast<unsigned char>(p1[common]) <
+           static_cast<unsigned char>(p2[common]) ? -1 : 1;
+}
+
+void merge_paths(std::istream &f1, std::istream &f2, int fd, MergeMode mode,
+                 unsigned int nclasses, unsigned int class1,
+                 unsigned int class2, bool front_code) {
+    // The sign of the counts of the second list
+    const long sign2 = mode == MERGE_SUBTRACT ? -1L : 1L;
+    // The counts of a single occurrence in each list
+    counts one1(1U, 1L), one2(1U, 1L);
+    if (nclasses > 0U) {
+        one1.resize(nclasses + 1U, 0L);
+        one2.resize(nclasses + 1U, 0L);
+        one1.at(class1 + 1U) = 1L;
+        one2.at(class2 + 1U) = 1L;
+    }
+    // Counts of paths only present in the second list
+    counts neg2;
+    HIDOST_TRACE2(merge_start, mode, front_code);
+    PathReader r1(f1), r2(f2);
+    PathWriter out(fd, mode, front_code);
+    bool has1 = r1.next(mode, one1), has2 = r2.next(mode, one2);
+    // A lower bound of the length of the prefix shared by both paths. A
+    // new path shares at least the minimum of this and the prefix it
+    // shares with its predecessor with the other path.
+    std::string::size_type common = 0U;
+
+    while (has1 and has2) {
+        const int cmp = compare_paths(r1.path, r2.path, common);
+        if (cmp < 0) {
+            out.put(r1.path, r1.c);
+            has1 = r1.next(mode, one1);
+            common = std::min(common, r1.shared);
+        } else if (cmp > 0) {
+            neg2.clear();
+            combine(neg2, r2.c, sign2);
+            out.put(r2.path, neg2);
+            has2 = r2.next(mode, one2);
+            common = std::min(common, r2.shared);
+        } else {
+            combine(r1.c, r2.c, sign2);
+            out.put(r1.path, r1.c);
+            has1 = r1.next(mode, one1);
+            has2 = r2.next(mode, one2);
+            common = std::min(r1.shared, r2.shared);
+        }
+    }
+
+    // Copy the trailer of the longer list
+    while (has1) {
+        out.put(r1.path, r1.c);
+        has1 = r1.next(mode, one1);
+    }
+    while (has2) {
+        neg2.clear();
+        combine(neg2, r2.c, sign2);
+        out.put(r2.path, neg2);
+        has2 = r2.next(mode, one2);
+    }
+    HIDOST_TRACE1(merge_done, out.lines);
+}
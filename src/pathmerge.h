@@ -0,0 +1,76 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * pathmerge.h
+ */
+
+#ifndef PATHMERGE_H_
+#define PATHMERGE_H_
+
+#include <istream>
+#include <string>
+
+/*
+ * How merge_paths() combines the counts of the two input lists.
+ */
+enum MergeMode {
+    // Every count read is treated as a one and counts are summed
+    MERGE_COUNT_ONE,
+    // Counts are summed, paths with a count of zero or less are dropped
+    MERGE_SUM,
+    // Counts of the second list are subtracted from those of the first,
+    // paths with a count of zero are dropped
+    MERGE_SUBTRACT
+};
+
+/*!
+ * \brief Merges two sorted lists of paths and their counts.
+ *
+ * Every line of the input streams holds a path string, a space, one or
+ * more space-separated counts and a newline. A line with several counts
+ * holds the total count followed by one count per class. Counts of paths
+ * are combined element-wise according to the merge mode. Whether a path
+ * is dropped depends on its total count. The result is written to the
+ * file descriptor fd, sorted by path.
+ *
+ * Input streams may be plain or front-coded, which is detected from
+ * their first byte. A front-coded stream starts with the header line
+ * "\0FC\n". In every following line, the path string is replaced by the
+ * length of the prefix it shares with the path of the previous line, a
+ * space and the rest of the path string. Since plain path files never
+ * start with a null byte, the header is unambiguous. Comparisons of
+ * paths skip the prefix that two paths are known to share.
+ *
+ * In MERGE_COUNT_ONE mode with nclasses > 0, the lines of the first
+ * stream get a total count of one and a count of one for class1, and
+ * those of the second stream likewise for class2.
+ *
+ * @param f1 the first input stream.
+ * @param f2 the second input stream.
+ * @param fd the open output file descriptor.
+ * @param mode how to combine the counts.
+ * @param nclasses the number of classes when counting per class.
+ * @param class1 the class of the first stream, from 0 to nclasses-1.
+ * @param class2 the class of the second stream, from 0 to nclasses-1.
+ * @param front_code if true, the output is front-coded.
+ */
+void merge_paths(std::istream &f1, std::istream &f2, int fd, MergeMode mode,
+                 unsigned int nclasses = 0U, unsigned int class1 = 0U,
+                 unsigned int class2 = 0U, bool front_code = false);
+
+#endif /* PATHMERGE_H_ */
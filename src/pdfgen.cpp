@@ -0,0 +1,441 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * pdfgen.cpp
+ */
+
+/*
+ * This program generates a corpus of synthetic PDF files with a
+ * controlled structure: deep page trees, large name and number trees,
+ * wide resource dictionaries, long arrays and reference cycles in the
+ * outline tree. These are the structures that path compaction targets
+ * and that dominate extraction time. The names of the generated files
+ * are printed to the standard output, one per line.
+ *
+ * Every shape parameter is a maximum. The value used for a file is drawn
+ * uniformly between half the maximum and the maximum, from a generator
+ * seeded with --seed, so that a corpus can be regenerated exactly.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+/*
+ * The shape of a generated PDF file.
+ */
+struct PdfShape {
+    // Depth and fanout of the page tree
+    unsigned int pages_depth;
+    unsigned int pages_fanout;
+    // Number of entries in the Dests name tree
+    unsigned int name_tree;
+    // Number of entries in the PageLabels number tree
+    unsigned int number_tree;
+    // Number of fonts and images in the shared Resources dictionary
+    unsigned int resources;
+    // Length of the Widths array of every font
+    unsigned int array_length;
+    // Number of items in the outline tree
+    unsigned int outline;
+};
+
+/*
+ * Builds a PDF file object by object and writes it with a cross-reference
+ * table.
+ */
+class PdfWriter {
+private:
+    std::vector<std::string> objects;
+public:
+    /*
+     * Reserves an object number for an object defined later.
+     */
+    unsigned int reserve() {
+        objects.push_back("");
+        return objects.size();
+    }
+
+    void define(unsigned int num, const std::string &body) {
+        objects[num - 1] = body;
+    }
+
+    unsigned int add(const std::string &body) {
+        objects.push_back(body);
+        return objects.size();
+    }
+
+    static std::string ref(unsigned int num) {
+        std::stringstream ss;
+        ss << num << " 0 R";
+        return ss.str();
+    }
+
+    void write(std::ostream &out, unsigned int root) const {
+        std::vector<std::streamoff> offsets;
+        std::stringstream ss;
+        ss << "%PDF-1.4\n%\xe2\xe3\xcf\xd3\n";
+        for (unsigned int i = 0U; i < objects.size(); i++) {
+            offsets.push_back(ss.tellp());
+            ss << (i + 1U) << " 0 obj\n" << objects[i] << "\nendobj\n";
+        }
+        const std::streamoff xref = ss.tellp();
+        ss << "xref\n0 " << (objects.size() + 1U) << "\n"
+           << "0000000000 65535 f \n";
+        for (const auto off : offsets) {
+            char buf[21];
+            std::snprintf(buf, sizeof(buf), "%010lld 00000 n \n",
+                          static_cast<long long>(off));
+            ss << buf;
+        }
+        ss << "trailer\n<< /Size " << (objects.size() + 1U) << " /Root "
+           << ref(root) << " >>\nstartxref\n" << xref << "\n%%EOF\n";
+        out << ss.str();
+    }
+};
+
+class PdfGenerator {
+private:
+    std::mt19937 rng;
+    PdfWriter w;
+    unsigned int resources_num;
+    unsigned int first_page;
+
+    unsigned int uniform(unsigned int n) {
+        return rng() % n;
+    }
+
+    /*
+     * Draws a shape parameter between max / 2 and max.
+     */
+    unsigned int draw(unsigned int max) {
+        if (max == 0U) {
+            return 0U;
+        }
+        const unsigned int min = std::max(max / 2U, 1U);
+        return min + uniform(max - min + 1U);
+    }
+
+    /*
+     * Writes a page tree node and returns its object number and the
+     * number of pages below it.
+     */
+    std::pair<unsigned int, unsigned int> pages(unsigned int depth,
+                                                unsigned int fanout,
+                                                unsigned int parent) {
+        const unsigned int num = w.reserve();
+        std::stringstream ss;
+        if (depth == 0U) {
+            const unsigned int contents = w.add(
+                    "<< /Length 38 >>\nstream\n"
+                    "BT /F0 12 Tf 72 712 Td (Hidost) Tj ET\n\nendstream");
+            ss << "<< /Type /Page /Parent " << PdfWriter::ref(parent)
+               << " /MediaBox [0 0 612 792] /Resources "
+               << PdfWriter::ref(resources_num)
+               << " /Contents " << PdfWriter::ref(contents) << " >>";
+            w.define(num, ss.str());
+            if (first_page == 0U) {
+                first_page = num;
+            }
+            return {num, 1U};
+        }
+        std::vector<unsigned int> kids;
+        unsigned int count = 0U;
+        for (unsigned int i = 0U; i < fanout; i++) {
+            auto kid = pages(depth - 1U, fanout, num);
+            kids.push_back(kid.first);
+            count += kid.second;
+        }
+        ss << "<< /Type /Pages";
+        if (parent != 0U) {
+            ss << " /Parent " << PdfWriter::ref(parent);
+        }
+        ss << " /Kids [";
+        for (const auto kid : kids) {
+            ss << ' ' << PdfWriter::ref(kid);
+        }
+        ss << " ] /Count " << count << " >>";
+        w.define(num, ss.str());
+        return {num, count};
+    }
+
+    static std::string tree_name(unsigned int i) {
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), "n%08u", i);
+        return buf;
+    }
+
+    /*
+     * Writes a two-level name or number tree and returns its root.
+     */
+    unsigned int tree(unsigned int entries, bool names) {
+        static const unsigned int LEAF_SIZE = 32U;
+        const unsigned int root = w.reserve();
+        std::stringstream rs;
+        rs << "<< /Kids [";
+        for (unsigned int first = 0U; first < entries; first += LEAF_SIZE) {
+            const unsigned int last = std::min(first + LEAF_SIZE, entries) - 1U;
+            std::stringstream ls;
+            if (names) {
+                // Zero-padded names keep the tree sorted
+                ls << "<< /Limits [(" << tree_name(first) << ") ("
+                   << tree_name(last) << ")] /Names [";
+                for (unsigned int i = first; i <= last; i++) {
+                    ls << " (" << tree_name(i) << ") ["
+                       << PdfWriter::ref(first_page) << " /XYZ 0 "
+                       << uniform(792U) << " 0]";
+                }
+            } else {
+                ls << "<< /Limits [" << first << ' ' << last << "] /Nums [";
+                for (unsigned int i = first; i <= last; i++) {
+                    ls << ' ' << i << " << /S /D /St " << (i + 1U) << " >>";
+                }
+            }
+            ls << " ] >>";
+            rs << ' ' << PdfWriter::ref(w.add(ls.str()));
+        }
+        rs << " ] >>";
+        w.define(root, rs.str());
+        return root;
+    }
+
+    /*
+     * Writes the outline tree. Its items refer to each other with Prev,
+     * Next and Parent, which makes up reference cycles.
+     */
+    unsigned int outline(unsigned int items) {
+        const unsigned int root = w.reserve();
+        std::vector<unsigned int> nums;
+        for (unsigned int i = 0U; i < items; i++) {
+            nums.push_back(w.reserve());
+        }
+        for (unsigned int i = 0U; i < items; i++) {
+            std::stringstream ss;
+            ss << "<< /Title (Item " << i << ") /Parent "
+               << PdfWriter::ref(root);
+            if (i > 0U) {
+                ss << " /Prev " << PdfWriter::ref(nums[i - 1U]);
+            }
+            if (i + 1U < items) {
+                ss << " /Next " << PdfWriter::ref(nums[i + 1U]);
+            }
+            ss << " /Dest [" << PdfWriter::ref(first_page) << " /Fit] >>";
+            w.define(nums[i], ss.str());
+        }
+        std::stringstream ss;
+        ss << "<< /Type /Outlines";
+        if (items > 0U) {
+            ss << " /First " << PdfWriter::ref(nums.front())
+               << " /Last " << PdfWriter::ref(nums.back());
+        }
+        ss << " /Count " << items << " >>";
+        w.define(root, ss.str());
+        return root;
+    }
+
+public:
+    explicit PdfGenerator(unsigned int seed) :
+            rng(seed), w(), resources_num(0U), first_page(0U) {
+    }
+
+    void generate(const PdfShape &max, std::ostream &out) {
+        PdfShape shape;
+        shape.pages_depth = draw(max.pages_depth);
+        shape.pages_fanout = draw(max.pages_fanout);
+        shape.name_tree = draw(max.name_tree);
+        shape.number_tree = draw(max.number_tree);
+        shape.resources = draw(max.resources);
+        shape.array_length = draw(max.array_length);
+        shape.outline = draw(max.outline);
+
+        w = PdfWriter();
+        first_page = 0U;
+
+        // Resources shared by all pages
+        std::stringstream widths;
+        widths << '[';
+        for (unsigned int i = 0U; i < shape.array_length; i++) {
+            widths << ' ' << (250U + uniform(750U));
+        }
+        widths << " ]";
+        const unsigned int widths_num = w.add(widths.str());
+        std::stringstream rs;
+        rs << "<< /ProcSet [/PDF /Text /ImageB] /Font <<";
+        for (unsigned int i = 0U; i < std::max(shape.resources, 1U); i++) {
+            std::stringstream fs;
+            fs << "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica"
+               << " /FirstChar 0 /LastChar "
+               << (shape.array_length ? shape.array_length - 1U : 0U)
+               << " /Widths " << PdfWriter::ref(widths_num) << " >>";
+            rs << " /F" << i << ' ' << PdfWriter::ref(w.add(fs.str()));
+        }
+        rs << " >> /XObject <<";
+        for (unsigned int i = 0U; i < shape.resources; i++) {
+            rs << " /Im" << i << ' ' << PdfWriter::ref(w.add(
+                    "<< /Type /XObject /Subtype /Image /Width 1 /Height 1"
+                    " /ColorSpace /DeviceGray /BitsPerComponent 8"
+                    " /Length 1 >>\nstream\n\x80\nendstream"));
+        }
+        rs << " >> >>";
+        resources_num = w.add(rs.str());
+
+        const unsigned int catalog = w.reserve();
+        // The root of the page tree is always a Pages node
+        const unsigned int pages_root = pages(std::max(shape.pages_depth, 1U),
+                                              std::max(shape.pages_fanout, 1U),
+                                              0U).first;
+        std::stringstream cs;
+        cs << "<< /Type /Catalog /Pages " << PdfWriter::ref(pages_root);
+        if (shape.name_tree > 0U) {
+            cs << " /Names << /Dests "
+               << PdfWriter::ref(tree(shape.name_tree, true)) << " >>";
+        }
+        if (shape.number_tree > 0U) {
+            cs << " /PageLabels "
+               << PdfWriter::ref(tree(shape.number_tree, false));
+        }
+        if (shape.outline > 0U) {
+            cs << " /Outlines " << PdfWriter::ref(outline(shape.outline));
+        }
+        cs << " >>";
+        w.define(catalog, cs.str());
+        w.write(out, catalog);
+    }
+};
+
+po::variables_map parse_arguments(int argc, char *argv[]) {
+    po::options_description desc(
+            "This program generates synthetic PDF files with a controlled "
+            "structure and prints their names. Every shape parameter is a "
+            "maximum; the value used for a file is drawn between half the "
+            "maximum and the maximum. Allowed options");
+    desc.add_options()
+            ("help", "produce help message")
+            ("output-dir,o",
+                    po::value<std::string>()->required(),
+                    "an existing directory where to write the files")
+            ("count,n",
+                    po::value<unsigned int>()->default_value(1U),
+                    "number of files to generate")
+            ("prefix,p",
+                    po::value<std::string>()->default_value("synth"),
+                    "prefix of the generated file names")
+            ("seed,s",
+                    po::value<unsigned int>()->default_value(1U),
+                    "seed of the random number generator")
+            ("pages-depth",
+                    po::value<unsigned int>()->default_value(3U),
+                    "depth of the Pages/Kids tree")
+            ("pages-fanout",
+                    po::value<unsigned int>()->default_value(4U),
+                    "number of Kids of every Pages node")
+            ("name-tree",
+                    po::value<unsigned int>()->default_value(64U),
+                    "number of entries in the Dests name tree")
+            ("number-tree",
+                    po::value<unsigned int>()->default_value(64U),
+                    "number of entries in the PageLabels number tree")
+            ("resources",
+                    po::value<unsigned int>()->default_value(16U),
+                    "number of fonts and images in the Resources dictionary")
+            ("array-length",
+                    po::value<unsigned int>()->default_value(256U),
+                    "length of the Widths arrays")
+            ("outline",
+                    po::value<unsigned int>()->default_value(32U),
+                    "number of items in the outline tree, which are linked "
+                    "by reference cycles");
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        std::exit(EXIT_SUCCESS);
+    }
+
+    try {
+        po::notify(vm);
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl << std::endl << desc << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return vm;
+}
+
+int run(int argc, char *argv[]) {
+    po::variables_map vm = parse_arguments(argc, argv);
+    const std::string OUTPUT_DIR = vm["output-dir"].as<std::string>();
+    const unsigned int COUNT = vm["count"].as<unsigned int>();
+    const std::string PREFIX = vm["prefix"].as<std::string>();
+    PdfShape max;
+    max.pages_depth = vm["pages-depth"].as<unsigned int>();
+    max.pages_fanout = vm["pages-fanout"].as<unsigned int>();
+    max.name_tree = vm["name-tree"].as<unsigned int>();
+    max.number_tree = vm["number-tree"].as<unsigned int>();
+    max.resources = vm["resources"].as<unsigned int>();
+    max.array_length = vm["array-length"].as<unsigned int>();
+    max.outline = vm["outline"].as<unsigned int>();
+
+    // Guard against page trees that do not fit in memory
+    double npages = 1.0;
+    for (unsigned int i = 0U; i < max.pages_depth; i++) {
+        npages *= std::max(max.pages_fanout, 1U);
+    }
+    if (npages > 1e6) {
+        throw "The page tree would have more than a million pages.";
+    }
+
+    PdfGenerator gen(vm["seed"].as<unsigned int>());
+    for (unsigned int i = 0U; i < COUNT; i++) {
+        std::stringstream fname;
+        fname << OUTPUT_DIR << '/' << PREFIX << i << ".pdf";
+        std::ofstream out(fname.str(), std::ios::binary | std::ios::trunc);
+        if (not out) {
+            throw "Unable to open an output file.";
+        }
+        gen.generate(max, out);
+        std::cout << fname.str() << '\n';
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+	try {
+		return run(argc, argv);
+	} catch (std::exception &e) {
+		std::cerr << "Exception caught: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	} catch (const char *e) {
+		std::cerr << "Exception caught: " << e << std::endl;
+		return EXIT_FAILURE;
+	} catch (...) {
+		std::cerr << "Unexpected exception caught." << std::endl;
+		return EXIT_FAILURE;
+	}
+}
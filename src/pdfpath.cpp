@@ -1,11 +1,14 @@
 #include "pdfpath.h"
 
+#include <cstdint>
 #include <cstdio>
 #include <utility>
 #include <vector>
 
 #include <boost/regex.hpp>
 
+#include "trace.h"
+
 namespace b = boost;
 
 void parse_pdfpaths(std::istream &in, std::vector<pdfpath> &v) {
@@ -187,6 +190,7 @@ void init_regex() {
 }
 
 std::string compact_pdfpath(const pdfpath &path) {
+    HIDOST_TRACE1(compact_start, path.size());
     static bool do_init = true;
     if (do_init) {
         init_regex();
@@ -197,5 +201,15 @@ std::string compact_pdfpath(const pdfpath &path) {
         pathstr = b::regex_replace(pathstr, re.first, re.second,
                                    b::match_default | b::format_all);
     }
+    HIDOST_TRACE1(compact_done, pathstr.size());
     return pathstr;
 }
+
+std::size_t pdfpath_hash(const char *str, std::size_t len) {
+    std::uint64_t h = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < len; i++) {
+        h ^= static_cast<unsigned char>(str[i]);
+        h *= 1099511628211ULL;
+    }
+    return static_cast<std::size_t>(h);
+}
@@ -1,6 +1,7 @@
 #ifndef PDFPATH_H_
 #define PDFPATH_H_
 
+#include <cstddef>
 #include <istream>
 #include <iostream>
 #include <sstream>
@@ -77,4 +78,12 @@ std::string get_pdfpath_string(std::istream &stream);
  */
 std::string compact_pdfpath(const pdfpath &path);
 
+/*!
+ * \brief Returns the FNV-1a hash of a path string.
+ *
+ * @param str the path string.
+ * @param len the length of the path string in bytes.
+ */
+std::size_t pdfpath_hash(const char *str, std::size_t len);
+
 #endif /*PDFPATH_H_*/
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * shard.cpp
+ */
+
+#include "shard.h"
+
+#include <sstream>
+
+Shard::Shard() :
+        index(0U), count(1U) {
+}
+
+Shard::Shard(const std::string &spec) :
+        index(0U), count(1U) {
+    std::istringstream in(spec);
+    char slash = '\0';
+    if (spec.find('-') != std::string::npos
+        or not (in >> index >> slash >> count) or slash != '/'
+        or in.peek() != EOF) {
+        throw "Malformed shard, expected i/n.";
+    }
+    if (count == 0U or index >= count) {
+        throw "Shard index must be between 0 and n-1.";
+    }
+}
+
+void Shard::range(std::size_t size, std::size_t &begin,
+                  std::size_t &end) const {
+    // Computed in 64 bits, so that size * count does not overflow
+    begin = static_cast<unsigned long long>(size) * index / count;
+    end = static_cast<unsigned long long>(size) * (index + 1U) / count;
+}
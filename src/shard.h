@@ -0,0 +1,67 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * shard.h
+ */
+
+#ifndef SHARD_H_
+#define SHARD_H_
+
+#include <cstddef>
+#include <string>
+
+/*!
+ * \brief A part of an input file list, for processing on several hosts.
+ *
+ * Shard i of n (0 <= i < n) is the i-th of n contiguous blocks of
+ * almost equal size. Concatenating the blocks of shards 0 to n-1 in
+ * order gives back the whole list.
+ */
+struct Shard {
+    unsigned int index;
+    unsigned int count;
+
+    // The whole list
+    Shard();
+
+    /*!
+     * \brief Parses a shard specification of the form "i/n".
+     *
+     * Throws a const char * on malformed specifications.
+     */
+    explicit Shard(const std::string &spec);
+
+    /*!
+     * \brief Computes the range [begin, end) of this shard in a list of
+     * the given size.
+     */
+    void range(std::size_t size, std::size_t &begin, std::size_t &end) const;
+
+    /*!
+     * \brief Keeps only the elements of this shard in the list.
+     */
+    template<typename T>
+    void select(T &list) const {
+        std::size_t begin, end;
+        range(list.size(), begin, end);
+        list.erase(list.begin() + end, list.end());
+        list.erase(list.begin(), list.begin() + begin);
+    }
+};
+
+#endif /* SHARD_H_ */
@@ -0,0 +1,737 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * swf2paths.cpp
+ */
+
+/*
+ * This program extracts and prints structural paths from SWF files, in
+ * the format of pdf2paths, or of pdf2vals with --values. The SWF header
+ * and tags are parsed natively, so that SWF files can be cached and
+ * counted by the PDF toolchain.
+ *
+ * Paths start at Header or Tags. Every tag adds the path
+ * Tags/<tag name>/Length and the paths of the fields parsed for its
+ * type, e.g., Tags/FileAttributes/ActionScript3. The control tags of
+ * sprites are nested under Tags/DefineSprite/ControlTags and the action
+ * records of DoAction and DoInitAction tags under Actions/<action name>.
+ * Strings are only recorded as present, with the value 1.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <zlib.h>
+
+#include "DocMetrics.h"
+#include "PathTable.h"
+#include "ValueStats.h"
+#include "pdfpath.h"
+#include "trace.h"
+
+#define PROG_NAME "swf2paths: "
+
+namespace po = boost::program_options;
+
+// Metrics of the file being processed
+DocMetrics metrics;
+// Where to write the metrics, if anywhere
+std::string metrics_file;
+
+void exit_error(const char *e) {
+    std::cerr << PROG_NAME << e << std::endl;
+    if (not metrics_file.empty()) {
+        metrics.error = e;
+        metrics.write_json(metrics_file.c_str());
+    }
+    std::exit(EXIT_FAILURE);
+}
+
+// True if path compaction is to be done
+bool do_compact = false;
+// True if values are to be printed instead of counts
+bool do_values = false;
+
+// Paths of the file and their counts or values
+PathTable<unsigned int> paths;
+PathTable<ValueStats> pathvals;
+
+// Maximal nesting depth of sprites
+static const unsigned int MAX_SPRITE_DEPTH = 32U;
+
+/*
+ * A bounds-checked reader of little-endian SWF data. Reading past the
+ * end throws a const char *.
+ */
+class SwfReader {
+private:
+    const unsigned char *data;
+    std::size_t size;
+    std::size_t pos;
+    // Bits of the current byte not yet read by ubits()
+    unsigned int bitbuf;
+    unsigned int nbits;
+
+    void need(std::size_t n) const {
+        if (n > size - pos) {
+            throw "Unexpected end of SWF data.";
+        }
+    }
+public:
+    SwfReader(const unsigned char *data, std::size_t size) :
+            data(data), size(size), pos(0U), bitbuf(0U), nbits(0U) {
+    }
+
+    std::size_t remaining() const {
+        return size - pos;
+    }
+    unsigned int u8() {
+        need(1U);
+        nbits = 0U;
+        return data[pos++];
+    }
+    unsigned int u16() {
+        const unsigned int lo = u8();
+        return lo | u8() << 8;
+    }
+    unsigned long u32() {
+        const unsigned long lo = u16();
+        return lo | static_cast<unsigned long>(u16()) << 16;
+    }
+    void skip(std::size_t n) {
+        need(n);
+        nbits = 0U;
+        pos += n;
+    }
+    /*
+     * Reads an unsigned bit field, most significant bit first.
+     */
+    unsigned long ubits(unsigned int n) {
+        unsigned long v = 0UL;
+        for (unsigned int i = 0U; i < n; i++) {
+            if (nbits == 0U) {
+                need(1U);
+                bitbuf = data[pos++];
+                nbits = 8U;
+            }
+            nbits--;
+            v = v << 1 | ((bitbuf >> nbits) & 1U);
+        }
+        return v;
+    }
+    long sbits(unsigned int n) {
+        const unsigned long v = ubits(n);
+        if (n > 0U and (v >> (n - 1U)) & 1UL) {
+            // Sign extension
+            return static_cast<long>(v) - (1L << n);
+        }
+        return static_cast<long>(v);
+    }
+    /*
+     * Skips a null-terminated string.
+     */
+    void string() {
+        nbits = 0U;
+        const void *end = std::memchr(data + pos, '\0', size - pos);
+        if (end == nullptr) {
+            throw "Unterminated string in SWF data.";
+        }
+        pos = static_cast<const unsigned char *>(end) - data + 1U;
+    }
+    /*
+     * Returns a reader of the next n bytes and skips them.
+     */
+    SwfReader sub(std::size_t n) {
+        need(n);
+        SwfReader r(data + pos, n);
+        skip(n);
+        return r;
+    }
+};
+
+/*
+ * Converts a path to a string, compacting chains of nested sprites into
+ * a single sprite if required.
+ */
+std::string swfpath_to_string(const pdfpath &path) {
+    static const std::string sprite("DefineSprite"), control("ControlTags");
+    std::string pathstr;
+    for (pdfpath::size_type i = 0U; i < path.size(); i++) {
+        if (do_compact and i >= 2U and path[i] == sprite and
+            path[i - 2U] == sprite and i + 1U < path.size() and
+            path[i + 1U] == control and path[i - 1U] == control) {
+            // Skip a repeated DefineSprite/ControlTags pair
+            i++;
+            continue;
+        }
+        pathstr += path[i];
+        pathstr += '\0';
+    }
+    pathstr += '\0';
+    return pathstr;
+}
+
+/*
+ * Records a value of the path extended by name.
+ */
+void emit(pdfpath &path, const char *name, double v) {
+    path.push_back(name);
+    const std::string pathstr(swfpath_to_string(path));
+    path.pop_back();
+    metrics.total_paths++;
+    if (do_values) {
+        pathvals.get(pathstr).add(v);
+    } else {
+        paths.get(pathstr, 0U)++;
+    }
+}
+
+const char *tag_name(unsigned int code) {
+    static const char *NAMES[] = {
+        "End", "ShowFrame", "DefineShape", nullptr, "PlaceObject",
+        "RemoveObject", "DefineBits", "DefineButton", "JPEGTables",
+        "SetBackgroundColor", "DefineFont", "DefineText", "DoAction",
+        "DefineFontInfo", "DefineSound", "StartSound", nullptr,
+        "DefineButtonSound", "SoundStreamHead", "SoundStreamBlock",
+        "DefineBitsLossless", "DefineBitsJPEG2", "DefineShape2",
+        "DefineButtonCxform", "Protect", nullptr, "PlaceObject2", nullptr,
+        "RemoveObject2", nullptr, nullptr, nullptr, "DefineShape3",
+        "DefineText2", "DefineButton2", "DefineBitsJPEG3",
+        "DefineBitsLossless2", "DefineEditText", nullptr, "DefineSprite",
+        nullptr, "ProductInfo", nullptr, "FrameLabel", nullptr,
+        "SoundStreamHead2", "DefineMorphShape", nullptr, "DefineFont2",
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        "ExportAssets", "ImportAssets", "EnableDebugger", "DoInitAction",
+        "DefineVideoStream", "VideoFrame", "DefineFontInfo2", "DebugID",
+        "EnableDebugger2", "ScriptLimits", "SetTabIndex", nullptr, nullptr,
+        "FileAttributes", "PlaceObject3", "ImportAssets2", "DoABCDefine",
+        "DefineFontAlignZones", "CSMTextSettings", "DefineFont3",
+        "SymbolClass", "Metadata", "DefineScalingGrid", nullptr, nullptr,
+        nullptr, "DoABC", "DefineShape4", "DefineMorphShape2", nullptr,
+        "DefineSceneAndFrameLabelData", "DefineBinaryData",
+        "DefineFontName", "StartSound2", "DefineBitsJPEG4", "DefineFont4",
+        nullptr, "EnableTelemetry"
+    };
+    if (code < sizeof(NAMES) / sizeof(NAMES[0]) and NAMES[code] != nullptr) {
+        return NAMES[code];
+    }
+    return "Unknown";
+}
+
+const char *action_name(unsigned int code) {
+    static const char *NAMES[0xA0] = { nullptr };
+    static bool do_init = true;
+    if (do_init) {
+        const std::pair<unsigned int, const char *> actions[] = {
+            {0x04, "ActionNextFrame"}, {0x05, "ActionPreviousFrame"},
+            {0x06, "ActionPlay"}, {0x07, "ActionStop"},
+            {0x08, "ActionToggleQuality"}, {0x09, "ActionStopSounds"},
+            {0x0A, "ActionAdd"}, {0x0B, "ActionSubtract"},
+            {0x0C, "ActionMultiply"}, {0x0D, "ActionDivide"},
+            {0x0E, "ActionEquals"}, {0x0F, "ActionLess"},
+            {0x10, "ActionAnd"}, {0x11, "ActionOr"}, {0x12, "ActionNot"},
+            {0x13, "ActionStringEquals"}, {0x14, "ActionStringLength"},
+            {0x15, "ActionStringExtract"}, {0x17, "ActionPop"},
+            {0x18, "ActionToInteger"}, {0x1C, "ActionGetVariable"},
+            {0x1D, "ActionSetVariable"}, {0x20, "ActionSetTarget2"},
+            {0x21, "ActionStringAdd"}, {0x22, "ActionGetProperty"},
+            {0x23, "ActionSetProperty"}, {0x24, "ActionCloneSprite"},
+            {0x25, "ActionRemoveSprite"}, {0x26, "ActionTrace"},
+            {0x27, "ActionStartDrag"}, {0x28, "ActionEndDrag"},
+            {0x29, "ActionStringLess"}, {0x2A, "ActionThrow"},
+            {0x2B, "ActionCastOp"}, {0x2C, "ActionImplementsOp"},
+            {0x30, "ActionRandomNumber"}, {0x31, "ActionMBStringLength"},
+            {0x32, "ActionCharToAscii"}, {0x33, "ActionAsciiToChar"},
+            {0x34, "ActionGetTime"}, {0x35, "ActionMBStringExtract"},
+            {0x36, "ActionMBCharToAscii"}, {0x37, "ActionMBAsciiToChar"},
+            {0x3A, "ActionDelete"}, {0x3B, "ActionDelete2"},
+            {0x3C, "ActionDefineLocal"}, {0x3D, "ActionCallFunction"},
+            {0x3E, "ActionReturn"}, {0x3F, "ActionModulo"},
+            {0x40, "ActionNewObject"}, {0x41, "ActionDefineLocal2"},
+            {0x42, "ActionInitArray"}, {0x43, "ActionInitObject"},
+            {0x44, "ActionTypeOf"}, {0x45, "ActionTargetPath"},
+            {0x46, "ActionEnumerate"}, {0x47, "ActionAdd2"},
+            {0x48, "ActionLess2"}, {0x49, "ActionEquals2"},
+            {0x4A, "ActionToNumber"}, {0x4B, "ActionToString"},
+            {0x4C, "ActionPushDuplicate"}, {0x4D, "ActionStackSwap"},
+            {0x4E, "ActionGetMember"}, {0x4F, "ActionSetMember"},
+            {0x50, "ActionIncrement"}, {0x51, "ActionDecrement"},
+            {0x52, "ActionCallMethod"}, {0x53, "ActionNewMethod"},
+            {0x54, "ActionInstanceOf"}, {0x55, "ActionEnumerate2"},
+            {0x60, "ActionBitAnd"}, {0x61, "ActionBitOr"},
+            {0x62, "ActionBitXor"}, {0x63, "ActionBitLShift"},
+            {0x64, "ActionBitRShift"}, {0x65, "ActionBitURShift"},
+            {0x66, "ActionStrictEquals"}, {0x67, "ActionGreater"},
+            {0x68, "ActionStringGreater"}, {0x69, "ActionExtends"},
+            {0x81, "ActionGotoFrame"}, {0x83, "ActionGetURL"},
+            {0x87, "ActionStoreRegister"}, {0x88, "ActionConstantPool"},
+            {0x8A, "ActionWaitForFrame"}, {0x8B, "ActionSetTarget"},
+            {0x8C, "ActionGoToLabel"}, {0x8D, "ActionWaitForFrame2"},
+            {0x8E, "ActionDefineFunction2"}, {0x8F, "ActionTry"},
+            {0x94, "ActionWith"}, {0x96, "ActionPush"},
+            {0x99, "ActionJump"}, {0x9A, "ActionGetURL2"},
+            {0x9B, "ActionDefineFunction"}, {0x9D, "ActionIf"},
+            {0x9E, "ActionCall"}, {0x9F, "ActionGotoFrame2"}
+        };
+        for (const auto &a : actions) {
+            NAMES[a.first] = a.second;
+        }
+        do_init = false;
+    }
+    if (code < 0xA0 and NAMES[code] != nullptr) {
+        return NAMES[code];
+    }
+    return "ActionUnknown";
+}
+
+/*
+ * Records the action records of a DoAction or DoInitAction tag. The value
+ * of an action is the length of its payload. Function bodies follow their
+ * definitions in the record stream, so their actions are included.
+ */
+void parse_actions(SwfReader &in, pdfpath &path) {
+    path.push_back("Actions");
+    while (in.remaining() > 0U) {
+        const unsigned int code = in.u8();
+        if (code == 0U) {
+            // ActionEndFlag
+            break;
+        }
+        unsigned int length = 0U;
+        if (code >= 0x80U) {
+            length = in.u16();
+            in.skip(length);
+        }
+        emit(path, action_name(code), length);
+    }
+    path.pop_back();
+}
+
+void parse_tags(SwfReader &in, pdfpath &path, unsigned int depth);
+
+/*
+ * Records the fields of a tag body.
+ */
+void parse_tag(unsigned int code, SwfReader &body, pdfpath &path,
+               unsigned int depth) {
+    switch (code) {
+    case 2: case 6: case 7: case 10: case 11: case 13: case 17: case 20:
+    case 21: case 22: case 23: case 32: case 33: case 34: case 35: case 36:
+    case 37: case 46: case 48: case 62: case 73: case 75: case 78: case 83:
+    case 84: case 88: case 90: case 91:
+        // Character definitions
+        emit(path, "CharacterId", body.u16());
+        break;
+    case 5:
+        emit(path, "CharacterId", body.u16());
+        emit(path, "Depth", body.u16());
+        break;
+    case 9:
+        emit(path, "Red", body.u8());
+        emit(path, "Green", body.u8());
+        emit(path, "Blue", body.u8());
+        break;
+    case 12:
+        parse_actions(body, path);
+        break;
+    case 14: {
+        emit(path, "SoundId", body.u16());
+        emit(path, "SoundFormat", body.ubits(4U));
+        emit(path, "SoundRate", body.ubits(2U));
+        emit(path, "SoundSize", body.ubits(1U));
+        emit(path, "SoundType", body.ubits(1U));
+        emit(path, "SoundSampleCount", body.u32());
+    }
+        break;
+    case 24:
+    case 58:
+    case 64:
+        if (code == 64U) {
+            body.u16(); // Reserved
+        }
+        if (body.remaining() > 0U) {
+            body.string();
+            emit(path, "Password", 1.0);
+        }
+        break;
+    case 26:
+        body.u8(); // Flags
+        emit(path, "Depth", body.u16());
+        break;
+    case 28:
+        emit(path, "Depth", body.u16());
+        break;
+    case 39:
+        emit(path, "SpriteId", body.u16());
+        emit(path, "FrameCount", body.u16());
+        if (depth < MAX_SPRITE_DEPTH) {
+            path.push_back("ControlTags");
+            parse_tags(body, path, depth + 1U);
+            path.pop_back();
+        }
+        break;
+    case 41:
+        emit(path, "ProductId", body.u32());
+        emit(path, "Edition", body.u32());
+        emit(path, "MajorVersion", body.u8());
+        emit(path, "MinorVersion", body.u8());
+        emit(path, "BuildLow", body.u32());
+        emit(path, "BuildHigh", body.u32());
+        {
+            const double lo = body.u32();
+            emit(path, "CompilationDate", lo + 4294967296.0 * body.u32());
+        }
+        break;
+    case 43:
+        body.string();
+        emit(path, "Name", 1.0);
+        if (body.remaining() > 0U) {
+            emit(path, "NamedAnchor", body.u8());
+        }
+        break;
+    case 56:
+    case 76: {
+        const unsigned int n = body.u16();
+        emit(path, "NumSymbols", n);
+        path.push_back("Symbol");
+        for (unsigned int i = 0U; i < n; i++) {
+            emit(path, "Tag", body.u16());
+            body.string();
+            emit(path, "Name", 1.0);
+        }
+        path.pop_back();
+    }
+        break;
+    case 57:
+    case 71: {
+        body.string();
+        emit(path, "URL", 1.0);
+        if (code == 71U) {
+            body.u16(); // Reserved
+        }
+        const unsigned int n = body.u16();
+        emit(path, "Count", n);
+        path.push_back("Symbol");
+        for (unsigned int i = 0U; i < n; i++) {
+            emit(path, "Tag", body.u16());
+            body.string();
+            emit(path, "Name", 1.0);
+        }
+        path.pop_back();
+    }
+        break;
+    case 59:
+        emit(path, "SpriteId", body.u16());
+        parse_actions(body, path);
+        break;
+    case 60:
+        emit(path, "CharacterId", body.u16());
+        emit(path, "NumFrames", body.u16());
+        emit(path, "Width", body.u16());
+        emit(path, "Height", body.u16());
+        break;
+    case 63:
+        emit(path, "UUID", 1.0);
+        break;
+    case 65:
+        emit(path, "MaxRecursionDepth", body.u16());
+        emit(path, "ScriptTimeoutSeconds", body.u16());
+        break;
+    case 69: {
+        const unsigned int flags = body.u8();
+        emit(path, "UseDirectBlit", (flags >> 6) & 1U);
+        emit(path, "UseGPU", (flags >> 5) & 1U);
+        emit(path, "HasMetadata", (flags >> 4) & 1U);
+        emit(path, "ActionScript3", (flags >> 3) & 1U);
+        emit(path, "UseNetwork", flags & 1U);
+    }
+        break;
+    case 70:
+        body.u16(); // Flags
+        emit(path, "Depth", body.u16());
+        break;
+    case 72:
+    case 82:
+        if (code == 82U) {
+            emit(path, "Flags", body.u32());
+            body.string();
+            emit(path, "Name", 1.0);
+        }
+        path.push_back("ABCData");
+        emit(path, "MinorVersion", body.u16());
+        emit(path, "MajorVersion", body.u16());
+        path.pop_back();
+        break;
+    case 77:
+        body.string();
+        emit(path, "Metadata", 1.0);
+        break;
+    case 87:
+        emit(path, "Tag", body.u16());
+        body.u32(); // Reserved
+        emit(path, "Data", body.remaining());
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Records a sequence of tags, up to an End tag or the end of the data.
+ */
+void parse_tags(SwfReader &in, pdfpath &path, unsigned int depth) {
+    while (in.remaining() >= 2U) {
+        const unsigned int header = in.u16();
+        const unsigned int code = header >> 6;
+        unsigned long length = header & 0x3FU;
+        if (length == 0x3FUL) {
+            // The file ends within the long tag header
+            if (in.remaining() < 4U) {
+                break;
+            }
+            length = in.u32();
+        }
+        // Keep what can be read of a truncated tag
+        const bool truncated = length > in.remaining();
+        if (truncated) {
+            length = in.remaining();
+        }
+        const char *name = tag_name(code);
+        path.push_back(name);
+        emit(path, "Length", length);
+        if (code == 0U) {
+            path.pop_back();
+            break;
+        }
+        if (std::strcmp(name, "Unknown") == 0) {
+            emit(path, "Code", code);
+        }
+        SwfReader body(in.sub(length));
+        try {
+            parse_tag(code, body, path, depth);
+        } catch (const char *) {
+            // A malformed tag body only loses its remaining fields
+        }
+        path.pop_back();
+        if (truncated) {
+            break;
+        }
+    }
+}
+
+/*
+ * Reads a whole SWF file and returns its uncompressed data, including
+ * the 8-byte file header. Throws a const char * on errors.
+ */
+std::vector<unsigned char> read_swf(const std::string &fname) {
+    std::ifstream in(fname, std::ios::binary);
+    if (not in) {
+        throw "Unable to open the input file.";
+    }
+    std::vector<unsigned char> raw((std::istreambuf_iterator<char>(in)),
+                                   std::istreambuf_iterator<char>());
+    if (raw.size() < 8U or raw[1] != 'W' or raw[2] != 'S') {
+        throw "Not an SWF file.";
+    }
+    if (raw[0] == 'F') {
+        return raw;
+    } else if (raw[0] == 'Z') {
+        throw "LZMA-compressed SWF files are not supported.";
+    } else if (raw[0] != 'C') {
+        throw "Not an SWF file.";
+    }
+
+    // Inflate the body into a buffer that grows as output arrives. The
+    // file length in the header is untrusted, so it only sizes the first
+    // chunk, up to a few times the compressed size.
+    const unsigned long file_length = raw[4] | raw[5] << 8 | raw[6] << 16 |
+                                      static_cast<unsigned long>(raw[7]) << 24;
+    static const unsigned long MAX_LENGTH = 1UL << 30;
+    static const unsigned long FIRST_CHUNK = 1UL << 16;
+    const unsigned long guess = 8UL + std::max(FIRST_CHUNK,
+                                               4UL * (raw.size() - 8U));
+    std::vector<unsigned char> data(raw.begin(), raw.begin() + 8);
+    data.resize(std::min(std::max(file_length, 9UL),
+                         std::min(guess, MAX_LENGTH)));
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    if (inflateInit(&zs) != Z_OK) {
+        throw "Unable to initialize zlib.";
+    }
+    zs.next_in = raw.data() + 8;
+    zs.avail_in = raw.size() - 8U;
+    std::size_t out_len = 8U;
+    int ret = Z_OK;
+    while (ret == Z_OK) {
+        if (out_len == data.size()) {
+            if (data.size() >= MAX_LENGTH) {
+                break;
+            }
+            data.resize(std::min(2UL * data.size(), MAX_LENGTH));
+        }
+        zs.next_out = data.data() + out_len;
+        zs.avail_out = data.size() - out_len;
+        ret = inflate(&zs, Z_NO_FLUSH);
+        out_len = data.size() - zs.avail_out;
+    }
+    inflateEnd(&zs);
+    // Keep what could be inflated of truncated or corrupt streams
+    if (ret != Z_STREAM_END and out_len == 8U) {
+        throw "Unable to decompress the SWF file.";
+    }
+    data.resize(out_len);
+    return data;
+}
+
+/*
+ * Records the paths of the header and the tags of the SWF data.
+ */
+void parse_swf(const std::vector<unsigned char> &data) {
+    SwfReader in(data.data(), data.size());
+    pdfpath path;
+    path.push_back("Header");
+    emit(path, "Compressed", in.u8() == 'C' ? 1.0 : 0.0);
+    in.skip(2U);
+    emit(path, "Version", in.u8());
+    emit(path, "FileLength", in.u32());
+    path.push_back("FrameSize");
+    const unsigned int nbits = in.ubits(5U);
+    emit(path, "Xmin", in.sbits(nbits));
+    emit(path, "Xmax", in.sbits(nbits));
+    emit(path, "Ymin", in.sbits(nbits));
+    emit(path, "Ymax", in.sbits(nbits));
+    path.pop_back();
+    // An 8.8 fixed-point number
+    emit(path, "FrameRate", in.u16() / 256.0);
+    emit(path, "FrameCount", in.u16());
+    path.pop_back();
+
+    path.push_back("Tags");
+    parse_tags(in, path, 0U);
+}
+
+/*
+ * Returns all paths and their counts or median values, sorted.
+ */
+std::string formatPaths() {
+    std::stringstream out;
+    if (do_values) {
+        pathvals.for_each_sorted([&out](const std::string &p, ValueStats &v) {
+            out << p << ' ' << v.median() << '\n';
+        });
+        metrics.distinct_paths = pathvals.size();
+    } else {
+        paths.for_each_sorted([&out](const std::string &p, unsigned int n) {
+            out << p << ' ' << n << '\n';
+        });
+        metrics.distinct_paths = paths.size();
+    }
+    const std::string buf(out.str());
+    metrics.output_bytes = buf.size();
+    return buf;
+}
+
+po::variables_map parse_arguments(int argc, char *argv[]) {
+    po::options_description desc(
+            "Usage: swf2paths [options] file_name (y|n)\n"
+            "This program extracts and prints structural paths from the "
+            "given SWF file, compacting them if the last argument is 'y'. "
+            "Allowed options");
+    desc.add_options()
+            ("help", "produce help message")
+            ("values", "print the median value of every path instead of "
+                    "its count, like pdf2vals")
+            ("metrics",
+                    po::value<std::string>(),
+                    "append per-document metrics as a JSON line to this file");
+    po::options_description hidden;
+    hidden.add_options()
+            ("args", po::value<std::vector<std::string> >(), "");
+    po::options_description all;
+    all.add(desc).add(hidden);
+    po::positional_options_description pos;
+    pos.add("args", -1);
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).options(all)
+                          .positional(pos).run(), vm);
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            std::exit(EXIT_SUCCESS);
+        }
+        po::notify(vm);
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl << std::endl << desc << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return vm;
+}
+
+int main(int argc, char *argv[]) {
+    // Parse command-line arguments
+    po::variables_map vm = parse_arguments(argc, argv);
+    const std::vector<std::string> ARGS = vm.count("args") ?
+            vm["args"].as<std::vector<std::string> >() :
+            std::vector<std::string>();
+    if (vm.count("metrics")) {
+        metrics_file = vm["metrics"].as<std::string>();
+    }
+    if (ARGS.size() != 2U) {
+        exit_error("Wrong count of arguments, see --help.");
+    }
+    if (strncmp(ARGS[1].c_str(), "y", 1) == 0) {
+        do_compact = true;
+    } else if (strncmp(ARGS[1].c_str(), "n", 1) == 0) {
+        do_compact = false;
+    } else {
+        exit_error("Last argument must be 'y' or 'n'.");
+    }
+    do_values = vm.count("values") > 0;
+
+    metrics.file = ARGS[0];
+    try {
+        const DocMetrics::clock::time_point start(DocMetrics::clock::now());
+        HIDOST_TRACE1(doc_open, ARGS[0].c_str());
+        const std::vector<unsigned char> data(read_swf(ARGS[0]));
+        metrics.open_ms = DocMetrics::elapsed_ms(start);
+
+        const DocMetrics::clock::time_point parse_start(DocMetrics::clock::now());
+        parse_swf(data);
+        metrics.traversal_ms = DocMetrics::elapsed_ms(parse_start);
+        const std::string output(formatPaths());
+        HIDOST_TRACE1(output_write, output.size());
+        std::cout << output << std::flush;
+    } catch (const char *e) {
+        exit_error(e);
+    }
+    if (not metrics_file.empty() and
+            not metrics.write_json(metrics_file.c_str())) {
+        std::cerr << PROG_NAME"Unable to write metrics." << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2014 Nedim Srndic, University of Tuebingen
+ *
+ * This file is part of Hidost.
+ *
+ * Hidost is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Hidost is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hidost.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * trace.h
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+/*
+ * Static tracepoints on the hot paths of the toolchain.
+ *
+ * If Hidost is configured with -DUSDT=ON, every HIDOST_TRACE*() macro
+ * expands to a USDT probe of the provider "hidost", which perf, bpftrace
+ * and SystemTap can attach to, e.g.:
+ *
+ *   bpftrace -e 'usdt:./src/pdf2paths:hidost:object_fetch { @[pid] = count(); }'
+ *
+ * A probe that is not attached costs a single nop instruction. Probe
+ * arguments must be integers or pointers, and are evaluated even if the
+ * probe is not attached, so they should be cheap. Without USDT, the
+ * macros expand to nothing and their arguments are not evaluated.
+ *
+ * The probes are listed in README.rst.
+ */
+
+#ifdef HIDOST_USDT
+#include <sys/sdt.h>
+
+#define HIDOST_TRACE0(name) DTRACE_PROBE(hidost, name)
+#define HIDOST_TRACE1(name, a1) DTRACE_PROBE1(hidost, name, a1)
+#define HIDOST_TRACE2(name, a1, a2) DTRACE_PROBE2(hidost, name, a1, a2)
+#define HIDOST_TRACE3(name, a1, a2, a3) \
+    DTRACE_PROBE3(hidost, name, a1, a2, a3)
+#else
+#define HIDOST_TRACE0(name) do {} while (0)
+#define HIDOST_TRACE1(name, a1) do {} while (0)
+#define HIDOST_TRACE2(name, a1, a2) do {} while (0)
+#define HIDOST_TRACE3(name, a1, a2, a3) do {} while (0)
+#endif
+
+#endif /* TRACE_H_ */